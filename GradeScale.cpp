@@ -0,0 +1,102 @@
+#include "GradeScale.h"
+
+GradeScale::GradeScale()
+{
+    static const float defaults[GRADE_COUNT] = {
+        4.0f, 4.0f, 3.7f,
+        3.3f, 3.0f, 2.7f,
+        2.3f, 2.0f, 1.7f,
+        1.3f, 1.0f, 0.7f,
+        0.0f,
+        0.0f};
+    memcpy(_points, defaults, sizeof(_points));
+    _courseCount = 0;
+    _revision = 0;
+}
+
+void GradeScale::setPoints(LetterGrade grade, double points)
+{
+    if (grade >= GRADE_NONE)
+        return;
+    _points[grade] = points;
+    _revision++;
+}
+
+double GradeScale::points(LetterGrade grade) const
+{
+    if (grade >= GRADE_COUNT)
+        return 0.0;
+    return _points[grade];
+}
+
+int GradeScale::findCourse(const char *course) const
+{
+    if (!course)
+        return -1;
+    for (int i = 0; i < _courseCount; i++)
+    {
+        if (strcmp(_courses[i].course, course) == 0)
+            return i;
+    }
+    return -1;
+}
+
+bool GradeScale::setCourse(const char *course, double credits, double weightBonus)
+{
+    int i = findCourse(course);
+    if (i < 0)
+    {
+        if (!course || _courseCount >= INK_MAX_COURSE_WEIGHTS)
+            return false;
+        i = _courseCount++;
+        strlcpy(_courses[i].course, course, sizeof(_courses[i].course));
+    }
+    _courses[i].credits = credits;
+    _courses[i].bonus = weightBonus;
+    _revision++;
+    return true;
+}
+
+void GradeScale::clearCourses()
+{
+    _courseCount = 0;
+    _revision++;
+}
+
+double GradeScale::credits(const char *course) const
+{
+    int i = findCourse(course);
+    return i < 0 ? 1.0 : _courses[i].credits;
+}
+
+double GradeScale::weightBonus(const char *course) const
+{
+    int i = findCourse(course);
+    return i < 0 ? 0.0 : _courses[i].bonus;
+}
+
+uint32_t GradeScale::revision() const
+{
+    return _revision;
+}
+
+LetterGrade GradeScale::parse(const char *grade)
+{
+    if (!grade || grade[0] == '\0')
+        return GRADE_NONE;
+
+    int base;
+    switch (grade[0])
+    {
+    case 'A': case 'a': base = GRADE_A; break;
+    case 'B': case 'b': base = GRADE_B; break;
+    case 'C': case 'c': base = GRADE_C; break;
+    case 'D': case 'd': base = GRADE_D; break;
+    default: return GRADE_F; // anything unrecognised counts as F, as before
+    }
+    if (grade[1] == '+')
+        return (LetterGrade)(base - 1);
+    if (grade[1] == '-')
+        return (LetterGrade)(base + 1);
+    return (LetterGrade)base;
+}
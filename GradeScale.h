@@ -0,0 +1,53 @@
+#ifndef GRADESCALE_H
+#define GRADESCALE_H
+
+#include <Arduino.h>
+
+#ifndef INK_MAX_COURSE_WEIGHTS
+#define INK_MAX_COURSE_WEIGHTS 12
+#endif
+
+enum LetterGrade : uint8_t {
+  GRADE_A_PLUS, GRADE_A, GRADE_A_MINUS,
+  GRADE_B_PLUS, GRADE_B, GRADE_B_MINUS,
+  GRADE_C_PLUS, GRADE_C, GRADE_C_MINUS,
+  GRADE_D_PLUS, GRADE_D, GRADE_D_MINUS,
+  GRADE_F,
+  GRADE_NONE, // no grade posted yet, left out of GPA
+  GRADE_COUNT
+};
+
+// Letter-to-points table plus optional per-course credits and weighting bonus
+// (e.g. +0.5 honors, +1.0 AP). Defaults to the standard 4.0 scale, 1 credit each.
+class GradeScale {
+public:
+  GradeScale();
+
+  void setPoints(LetterGrade grade, double points);
+  double points(LetterGrade grade) const;
+
+  bool setCourse(const char *course, double credits, double weightBonus = 0.0);
+  void clearCourses();
+  double credits(const char *course) const;
+  double weightBonus(const char *course) const;
+
+  uint32_t revision() const; // bumped on every change, used to invalidate cached GPAs
+
+  static LetterGrade parse(const char *grade);
+
+private:
+  struct CourseWeight {
+    char course[48];
+    float credits;
+    float bonus;
+  };
+
+  int findCourse(const char *course) const;
+
+  float _points[GRADE_COUNT];
+  CourseWeight _courses[INK_MAX_COURSE_WEIGHTS];
+  uint8_t _courseCount;
+  uint32_t _revision;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "InkAstronomy.h"
+
+static const double RAD = M_PI / 180.0;
+
+static double wrap360(double deg)
+{
+    deg = fmod(deg, 360.0);
+    return deg < 0 ? deg + 360.0 : deg;
+}
+
+double InkAstronomy::julianDay(time_t when)
+{
+    return (double)when / 86400.0 + 2440587.5;
+}
+
+// NOAA solar calculator (Meeus, Astronomical Algorithms ch. 25)
+void InkAstronomy::sunPosition(double jd, double &ra, double &dec, double &eqTimeMin, double &longitude)
+{
+    double t = (jd - 2451545.0) / 36525.0;
+    double l0 = wrap360(280.46646 + t * (36000.76983 + t * 0.0003032));
+    double m = 357.52911 + t * (35999.05029 - 0.0001537 * t);
+    double e = 0.016708634 - t * (0.000042037 + 0.0000001267 * t);
+    double c = sin(m * RAD) * (1.914602 - t * (0.004817 + 0.000014 * t)) +
+               sin(2 * m * RAD) * (0.019993 - 0.000101 * t) + sin(3 * m * RAD) * 0.000289;
+    double omega = 125.04 - 1934.136 * t;
+    longitude = l0 + c - 0.00569 - 0.00478 * sin(omega * RAD);
+
+    double obliquity = 23.0 + (26.0 + (21.448 - t * (46.815 + t * (0.00059 - t * 0.001813))) / 60.0) / 60.0;
+    obliquity += 0.00256 * cos(omega * RAD);
+
+    dec = asin(sin(obliquity * RAD) * sin(longitude * RAD)) / RAD;
+    ra = wrap360(atan2(cos(obliquity * RAD) * sin(longitude * RAD), cos(longitude * RAD)) / RAD);
+
+    double y = tan(obliquity * RAD / 2);
+    y *= y;
+    eqTimeMin = 4.0 / RAD * (y * sin(2 * l0 * RAD) - 2 * e * sin(m * RAD) + 4 * e * y * sin(m * RAD) * cos(2 * l0 * RAD) -
+                             0.5 * y * y * sin(4 * l0 * RAD) - 1.25 * e * e * sin(2 * m * RAD));
+}
+
+// Low-precision lunar series (Astronomical Almanac, section D)
+void InkAstronomy::moonPosition(double jd, double &ra, double &dec, double &longitude, double &parallax)
+{
+    double t = (jd - 2451545.0) / 36525.0;
+    longitude = 218.32 + 481267.881 * t + 6.29 * sin((135.0 + 477198.87 * t) * RAD) -
+                1.27 * sin((259.3 - 413335.36 * t) * RAD) + 0.66 * sin((235.7 + 890534.22 * t) * RAD) +
+                0.21 * sin((269.9 + 954397.74 * t) * RAD) - 0.19 * sin((357.5 + 35999.05 * t) * RAD) -
+                0.11 * sin((186.5 + 966404.03 * t) * RAD);
+    longitude = wrap360(longitude);
+    double latitude = 5.13 * sin((93.3 + 483202.02 * t) * RAD) + 0.28 * sin((228.2 + 960400.89 * t) * RAD) -
+                      0.28 * sin((318.3 + 6003.15 * t) * RAD) - 0.17 * sin((217.6 - 407332.21 * t) * RAD);
+    parallax = 0.9508 + 0.0518 * cos((135.0 + 477198.87 * t) * RAD) + 0.0095 * cos((259.3 - 413335.36 * t) * RAD) +
+               0.0078 * cos((235.7 + 890534.22 * t) * RAD) + 0.0028 * cos((269.9 + 954397.74 * t) * RAD);
+
+    double obliquity = (23.439 - 0.013 * t) * RAD;
+    double l = longitude * RAD, b = latitude * RAD;
+    double x = cos(b) * cos(l);
+    double y = cos(obliquity) * cos(b) * sin(l) - sin(obliquity) * sin(b);
+    double z = sin(obliquity) * cos(b) * sin(l) + cos(obliquity) * sin(b);
+    ra = wrap360(atan2(y, x) / RAD);
+    dec = asin(z) / RAD;
+}
+
+// Geometric altitude of a body at (ra, dec) for an observer at lat/lon
+double InkAstronomy::altitude(double lat, double lon, double jd, double ra, double dec)
+{
+    double d = jd - 2451545.0;
+    double gmst = wrap360(280.46061837 + 360.98564736629 * d);
+    double hourAngle = (gmst + lon - ra) * RAD;
+    return asin(sin(lat * RAD) * sin(dec * RAD) + cos(lat * RAD) * cos(dec * RAD) * cos(hourAngle)) / RAD;
+}
+
+double InkAstronomy::sunElevation(double lat, double lon, time_t when)
+{
+    double jd = julianDay(when), ra, dec, eqTime, longitude;
+    sunPosition(jd, ra, dec, eqTime, longitude);
+    return altitude(lat, lon, jd, ra, dec);
+}
+
+double InkAstronomy::moonElevation(double lat, double lon, time_t when)
+{
+    double jd = julianDay(when), ra, dec, longitude, parallax;
+    moonPosition(jd, ra, dec, longitude, parallax);
+    double h = altitude(lat, lon, jd, ra, dec);
+    return h - parallax * cos(h * RAD); // seen from the surface, not the Earth's centre
+}
+
+bool InkAstronomy::isDaytime(double lat, double lon, time_t when)
+{
+    return sunElevation(lat, lon, when) > -0.833; // upper limb on the refracted horizon
+}
+
+// Moon minus sun ecliptic longitude: 0 new, 90 first quarter, 180 full
+double InkAstronomy::moonElongation(time_t when)
+{
+    double jd = julianDay(when), ra, dec, eqTime, sunLongitude, moonLongitude, parallax;
+    sunPosition(jd, ra, dec, eqTime, sunLongitude);
+    moonPosition(jd, ra, dec, moonLongitude, parallax);
+    return wrap360(moonLongitude - sunLongitude);
+}
+
+int InkAstronomy::moonIllumination(time_t when)
+{
+    return (int)lround((1.0 - cos(moonElongation(when) * RAD)) / 2.0 * 100.0);
+}
+
+const char *InkAstronomy::moonPhaseName(time_t when)
+{
+    // The named phases are instants; give each the day around it (about 6 degrees either side)
+    double e = moonElongation(when);
+    if (e < 6 || e >= 354)
+        return "New Moon";
+    if (e < 84)
+        return "Waxing Crescent";
+    if (e < 96)
+        return "First Quarter";
+    if (e < 174)
+        return "Waxing Gibbous";
+    if (e < 186)
+        return "Full Moon";
+    if (e < 264)
+        return "Waning Gibbous";
+    if (e < 276)
+        return "Last Quarter";
+    return "Waning Crescent";
+}
+
+time_t InkAstronomy::localMidnight(time_t when)
+{
+    struct tm local;
+    localtime_r(&when, &local);
+    local.tm_hour = 0;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+    return mktime(&local);
+}
+
+// Scans the day in 10-minute steps for horizon crossings, then refines each
+// one by bisection to a few seconds.
+void InkAstronomy::crossings(double lat, double lon, time_t start, bool moon, time_t &rise, time_t &set)
+{
+    const int STEP = 600;
+    // Upper limb on the refracted horizon: 34' of refraction plus the
+    // semi-diameter. moonElevation() is already topocentric, so the moon's
+    // parallax is not subtracted again; its semi-diameter barely changes in a day.
+    double horizon = -0.833;
+    if (moon)
+    {
+        double ra, dec, longitude, parallax;
+        moonPosition(julianDay(start + 12 * 3600), ra, dec, longitude, parallax);
+        horizon = -0.5667 - 0.2725 * parallax;
+    }
+    rise = set = 0;
+
+    time_t end = localMidnight(start + 36 * 3600); // next midnight, also across DST changes
+    double prev = (moon ? moonElevation(lat, lon, start) : sunElevation(lat, lon, start)) - horizon;
+    for (time_t t = start + STEP; t - STEP < end; t += STEP)
+    {
+        time_t step = t > end ? end : t;
+        double cur = (moon ? moonElevation(lat, lon, step) : sunElevation(lat, lon, step)) - horizon;
+        if ((prev < 0) != (cur < 0))
+        {
+            time_t lo = step - STEP, hi = step;
+            bool rising = prev < 0;
+            while (hi - lo > 5)
+            {
+                time_t mid = lo + (hi - lo) / 2;
+                double h = (moon ? moonElevation(lat, lon, mid) : sunElevation(lat, lon, mid)) - horizon;
+                if ((h < 0) == rising)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+            if (rising && rise == 0)
+                rise = lo + (hi - lo) / 2;
+            else if (!rising && set == 0)
+                set = lo + (hi - lo) / 2;
+        }
+        prev = cur;
+        if (step == end)
+            break;
+    }
+}
+
+InkAstronomy::Events InkAstronomy::events(double lat, double lon, time_t when)
+{
+    Events e;
+    time_t start = localMidnight(when);
+    crossings(lat, lon, start, false, e.sunrise, e.sunset);
+    crossings(lat, lon, start, true, e.moonrise, e.moonset);
+    return e;
+}
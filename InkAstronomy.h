@@ -0,0 +1,41 @@
+#ifndef INKASTRONOMY_H
+#define INKASTRONOMY_H
+
+#include <Arduino.h>
+#include <time.h>
+
+// Sun and moon positions from latitude/longitude (degrees, east and north
+// positive) and a UTC time. The sun follows the NOAA solar calculator, good to
+// about a minute for rise and set outside the polar regions. The moon uses the
+// low-precision series from the Astronomical Almanac, good to a few minutes.
+//
+// Rise and set times are found within the local calendar day that contains
+// `when`, using the system time zone (configTime / TZ). They are 0 when the body
+// does not rise or set that day.
+class InkAstronomy {
+public:
+  struct Events {
+    time_t sunrise;
+    time_t sunset;
+    time_t moonrise;
+    time_t moonset;
+  };
+
+  static Events events(double lat, double lon, time_t when);
+  static double sunElevation(double lat, double lon, time_t when);  // degrees, refraction not included
+  static double moonElevation(double lat, double lon, time_t when); // degrees, topocentric
+  static bool isDaytime(double lat, double lon, time_t when);
+  static int moonIllumination(time_t when);     // percent of the disc lit
+  static const char *moonPhaseName(time_t when); // "New Moon" ... "Waning Crescent"
+
+private:
+  static double julianDay(time_t when);
+  static void sunPosition(double jd, double &ra, double &dec, double &eqTimeMin, double &longitude);
+  static void moonPosition(double jd, double &ra, double &dec, double &longitude, double &parallax);
+  static double altitude(double lat, double lon, double jd, double ra, double dec);
+  static double moonElongation(time_t when);
+  static time_t localMidnight(time_t when);
+  static void crossings(double lat, double lon, time_t start, bool moon, time_t &rise, time_t &set);
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "InkCommandJournal.h"
+#include "NVSManager.h"
+
+static const uint8_t JOURNAL_VERSION = 1;
+static const char *JOURNAL_KEY = "spjournal";
+
+InkCommandJournal::InkCommandJournal()
+{
+    clear();
+}
+
+void InkCommandJournal::clear()
+{
+    _count = 0;
+}
+
+int InkCommandJournal::size() const
+{
+    return _count;
+}
+
+const InkCommandJournal::Command &InkCommandJournal::at(int index) const
+{
+    return _commands[index];
+}
+
+void InkCommandJournal::removeAt(int index)
+{
+    memmove(&_commands[index], &_commands[index + 1], (_count - index - 1) * sizeof(Command));
+    _count--;
+}
+
+// "play" without a URI only resumes, so a pause cancels it
+bool InkCommandJournal::isResume(const Command &command)
+{
+    return strcmp(command.action, "play") == 0 && command.uri[0] == '\0';
+}
+
+void InkCommandJournal::push(const Command &command)
+{
+    if (strcmp(command.action, "volume") == 0)
+    {
+        // Volume is absolute: only the last value matters, unless playback moved devices since
+        for (int i = _count - 1; i >= 0 && strcmp(_commands[i].action, "transfer") != 0; i--)
+        {
+            if (strcmp(_commands[i].action, "volume") == 0)
+            {
+                removeAt(i);
+                break;
+            }
+        }
+    }
+    else if (_count > 0)
+    {
+        const Command &last = _commands[_count - 1];
+        if (strcmp(command.action, "seek") == 0 && strcmp(last.action, "seek") == 0)
+        {
+            _count--;
+        }
+        else if ((isResume(command) && strcmp(last.action, "pause") == 0) ||
+                 (strcmp(command.action, "pause") == 0 && isResume(last)))
+        {
+            _count--;
+            return;
+        }
+    }
+
+    if (_count == INK_JOURNAL_CAPACITY)
+        removeAt(0);
+    _commands[_count++] = command;
+}
+
+bool InkCommandJournal::popFront(Command &out)
+{
+    if (_count == 0)
+        return false;
+    out = _commands[0];
+    removeAt(0);
+    return true;
+}
+
+void InkCommandJournal::pushFront(const Command &command)
+{
+    if (_count == INK_JOURNAL_CAPACITY)
+        _count--; // the newest goes; order matters more at the front
+    memmove(&_commands[1], &_commands[0], _count * sizeof(Command));
+    _commands[0] = command;
+    _count++;
+}
+
+// Blob layout: version, count, then the used commands
+bool InkCommandJournal::load(const char *ns)
+{
+    clear();
+    size_t capacity = 2 + sizeof(_commands);
+    uint8_t *blob = (uint8_t *)malloc(capacity);
+    if (!blob)
+        return false;
+    size_t len = NVSManager::loadBlob(JOURNAL_KEY, blob, capacity, ns);
+    bool ok = len >= 2 && blob[0] == JOURNAL_VERSION && blob[1] <= INK_JOURNAL_CAPACITY &&
+              len == 2 + blob[1] * sizeof(Command);
+    if (ok)
+    {
+        _count = blob[1];
+        memcpy(_commands, blob + 2, _count * sizeof(Command));
+    }
+    free(blob);
+    return ok;
+}
+
+void InkCommandJournal::save(const char *ns) const
+{
+    size_t len = 2 + _count * sizeof(Command);
+    uint8_t *blob = (uint8_t *)malloc(len);
+    if (!blob)
+        return;
+    blob[0] = JOURNAL_VERSION;
+    blob[1] = _count;
+    memcpy(blob + 2, _commands, _count * sizeof(Command));
+    NVSManager::saveBlob(JOURNAL_KEY, blob, len, ns);
+    free(blob);
+}
@@ -0,0 +1,52 @@
+#ifndef INKCOMMANDJOURNAL_H
+#define INKCOMMANDJOURNAL_H
+
+#include <Arduino.h>
+
+#ifndef INK_JOURNAL_CAPACITY
+#define INK_JOURNAL_CAPACITY 16 // pending playback commands; the oldest is dropped when full
+#endif
+#ifndef INK_JOURNAL_MAX_AGE_S
+#define INK_JOURNAL_MAX_AGE_S 600 // older commands are dropped instead of replayed
+#endif
+
+// Playback commands waiting for the network, oldest first. push() folds
+// redundant input together before it is stored:
+//   - a volume replaces any pending volume (after the last transfer)
+//   - a seek replaces a seek right before it
+//   - play and pause right after each other cancel (not a play with a URI)
+// The journal is one NVS blob, so commands survive a reboot while offline.
+class InkCommandJournal {
+public:
+  struct Command {
+    char action[12];
+    char uri[64];
+    char state[12];
+    char device[48]; // target_device_id
+    int16_t volume;   // -1 when unset
+    int32_t position; // ms, -1 when unset
+    uint32_t queuedAt; // epoch seconds, 0 before NTP sync
+  };
+
+  InkCommandJournal();
+
+  void clear();
+  int size() const;
+  const Command &at(int index) const;
+
+  void push(const Command &command);
+  bool popFront(Command &out);
+  void pushFront(const Command &command); // puts back a command that could not be sent
+
+  bool load(const char *ns);
+  void save(const char *ns) const;
+
+private:
+  void removeAt(int index);
+  static bool isResume(const Command &command);
+
+  uint8_t _count;
+  Command _commands[INK_JOURNAL_CAPACITY];
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "InkHeapMonitor.h"
+#include <esp_heap_caps.h>
+
+InkHeapMonitor::InkHeapMonitor()
+{
+    reset();
+}
+
+void InkHeapMonitor::reset()
+{
+    _count = 0;
+    _spacing = INK_HEAP_SAMPLE_MS;
+    _baseline = _lowest = InkHeapSample();
+}
+
+InkHeapSample InkHeapMonitor::read(uint32_t now)
+{
+    InkHeapSample sample;
+    sample.at = now;
+    sample.freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    sample.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    sample.fragmentation = sample.freeBytes > 0 ? 100 - (uint64_t)sample.largestBlock * 100 / sample.freeBytes : 0;
+    return sample;
+}
+
+bool InkHeapMonitor::due(uint32_t now) const
+{
+    return _count == 0 || now - _samples[_count - 1].at >= _spacing;
+}
+
+void InkHeapMonitor::record(const InkHeapSample &sample)
+{
+    if (_count == 0)
+        _baseline = _lowest = sample;
+    if (sample.largestBlock < _lowest.largestBlock)
+        _lowest = sample;
+    if (_count == INK_HEAP_SAMPLES)
+        thin();
+    _samples[_count++] = sample;
+}
+
+// Halves the history, keeping the worse sample of each pair
+void InkHeapMonitor::thin()
+{
+    int kept = 0;
+    for (int i = 0; i + 1 < _count; i += 2)
+    {
+        const InkHeapSample &a = _samples[i];
+        const InkHeapSample &b = _samples[i + 1];
+        _samples[kept++] = b.largestBlock < a.largestBlock ? b : a;
+    }
+    if (_count % 2)
+        _samples[kept++] = _samples[_count - 1];
+    _count = kept;
+    _spacing *= 2;
+}
+
+int InkHeapMonitor::size() const
+{
+    return _count;
+}
+
+const InkHeapSample &InkHeapMonitor::at(int index) const
+{
+    return _samples[index];
+}
+
+const InkHeapSample &InkHeapMonitor::baseline() const
+{
+    return _baseline;
+}
+
+const InkHeapSample &InkHeapMonitor::lowest() const
+{
+    return _lowest;
+}
+
+uint32_t InkHeapMonitor::spacing() const
+{
+    return _spacing;
+}
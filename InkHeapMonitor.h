@@ -0,0 +1,53 @@
+#ifndef INKHEAPMONITOR_H
+#define INKHEAPMONITOR_H
+
+#include <Arduino.h>
+
+#ifndef INK_HEAP_SAMPLES
+#define INK_HEAP_SAMPLES 32 // samples kept; older ones are thinned out
+#endif
+#ifndef INK_HEAP_SAMPLE_MS
+#define INK_HEAP_SAMPLE_MS 60000 // initial spacing, doubles each time the history fills
+#endif
+
+struct InkHeapSample {
+  uint32_t at;           // millis()
+  uint32_t freeBytes;
+  uint32_t largestBlock; // largest single allocation that would succeed
+  uint8_t fragmentation; // percent of the free heap outside the largest block
+};
+
+// Heap history over an unbounded run in fixed memory. When the ring is full,
+// neighbouring samples are merged, keeping the one with the smaller largest
+// block, and the spacing doubles: a week-long run ends up with samples a few
+// hours apart that still show the worst point of each stretch. The first
+// sample after reset() is kept aside as the baseline.
+//
+// Not thread-safe; InkBridge guards it with its config lock.
+class InkHeapMonitor {
+public:
+  InkHeapMonitor();
+
+  void reset();
+  static InkHeapSample read(uint32_t now); // current heap state
+
+  bool due(uint32_t now) const; // spacing since the last sample has passed
+  void record(const InkHeapSample &sample);
+
+  int size() const;
+  const InkHeapSample &at(int index) const; // 0 = oldest
+  const InkHeapSample &baseline() const;
+  const InkHeapSample &lowest() const; // smallest largest block seen
+  uint32_t spacing() const;
+
+private:
+  void thin();
+
+  InkHeapSample _samples[INK_HEAP_SAMPLES];
+  InkHeapSample _baseline;
+  InkHeapSample _lowest;
+  uint32_t _spacing;
+  uint16_t _count;
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include "InkHistoryStore.h"
+#include "NVSManager.h"
+
+static const uint8_t STORE_VERSION = 1;
+
+InkHistoryStore::InkHistoryStore()
+{
+    reset();
+}
+
+void InkHistoryStore::reset(const char *location)
+{
+    strlcpy(_location, location ? location : "", sizeof(_location));
+    _count = 0;
+}
+
+const char *InkHistoryStore::location() const
+{
+    return _location;
+}
+
+int InkHistoryStore::size() const
+{
+    return _count;
+}
+
+const InkHistoryStore::Day &InkHistoryStore::at(int index) const
+{
+    return _days[index];
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+int32_t InkHistoryStore::dayNumber(const char *date)
+{
+    int y, m, d;
+    if (!date || sscanf(date, "%4d-%2d-%2d", &y, &m, &d) != 3 || m < 1 || m > 12 || d < 1 || d > 31)
+        return -1;
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int32_t days = era * 146097 + (int32_t)doe - 719468;
+    return days >= 0 && days <= 0xFFFF ? days : -1;
+}
+
+void InkHistoryStore::formatDay(int32_t day, char *out, size_t size)
+{
+    time_t t = (time_t)day * 86400;
+    struct tm utc;
+    gmtime_r(&t, &utc);
+    strftime(out, size, "%Y-%m-%d", &utc);
+}
+
+// Index of the first stored day that is not before `day`
+int InkHistoryStore::lowerBound(int32_t day) const
+{
+    int lo = 0, hi = _count;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (_days[mid].day < day)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+int InkHistoryStore::find(int32_t day) const
+{
+    int i = lowerBound(day);
+    return i < _count && _days[i].day == day ? i : -1;
+}
+
+int InkHistoryStore::find(const char *date) const
+{
+    int32_t day = dayNumber(date);
+    return day < 0 ? -1 : find(day);
+}
+
+bool InkHistoryStore::put(const char *date, float avgTemp, const char *condition)
+{
+    int32_t day = dayNumber(date);
+    if (day < 0)
+        return false;
+
+    int16_t temp = (int16_t)lroundf(avgTemp * 10.0f);
+    if (!condition)
+        condition = "";
+    int i = lowerBound(day);
+    if (i < _count && _days[i].day == day)
+    {
+        if (_days[i].avgTemp == temp && strncmp(_days[i].condition, condition, sizeof(_days[i].condition) - 1) == 0)
+            return false; // saves a flash write for a day fetched again
+    }
+    else
+    {
+        if (_count == INK_HISTORY_CAPACITY)
+        {
+            if (i == 0)
+                return false; // older than everything kept
+            memmove(&_days[0], &_days[1], (i - 1) * sizeof(Day));
+            i--;
+        }
+        else
+        {
+            memmove(&_days[i + 1], &_days[i], (_count - i) * sizeof(Day));
+            _count++;
+        }
+    }
+    Day &slot = _days[i];
+    slot.day = (uint16_t)day;
+    slot.avgTemp = temp;
+    strlcpy(slot.condition, condition, sizeof(slot.condition));
+    return true;
+}
+
+bool InkHistoryStore::gap(int32_t from, int32_t to, int32_t &gapFrom, int32_t &gapTo) const
+{
+    int i = lowerBound(from);
+    for (int32_t day = from; day <= to; day++, i++)
+    {
+        if (i < _count && _days[i].day == day)
+            continue;
+        gapFrom = day;
+        while (day < to && !(i < _count && _days[i].day == day + 1))
+            day++;
+        gapTo = day;
+        return true;
+    }
+    return false;
+}
+
+// NVS keys are limited to 15 characters, so locations are hashed (FNV-1a)
+void InkHistoryStore::storageKey(const char *location, char *key, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (const char *p = location; *p; p++)
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    snprintf(key, size, "hist%08lx", (unsigned long)hash);
+}
+
+bool InkHistoryStore::load(const char *location, const char *ns)
+{
+    reset(location);
+    char key[16];
+    storageKey(_location, key, sizeof(key));
+
+    // Blob layout: version, location, count, then the used days
+    uint8_t *blob = (uint8_t *)malloc(1 + sizeof(_location) + sizeof(_count) + sizeof(_days));
+    if (!blob)
+        return false;
+    size_t len = NVSManager::loadBlob(key, blob, 1 + sizeof(_location) + sizeof(_count) + sizeof(_days), ns);
+    size_t header = 1 + sizeof(_location) + sizeof(_count);
+    bool ok = false;
+    if (len >= header && blob[0] == STORE_VERSION && strncmp((const char *)blob + 1, _location, sizeof(_location)) == 0)
+    {
+        uint16_t count;
+        memcpy(&count, blob + 1 + sizeof(_location), sizeof(count));
+        if (count <= INK_HISTORY_CAPACITY && len == header + count * sizeof(Day))
+        {
+            memcpy(_days, blob + header, count * sizeof(Day));
+            _count = count;
+            ok = true;
+        }
+    }
+    free(blob);
+    return ok;
+}
+
+void InkHistoryStore::save(const char *ns) const
+{
+    char key[16];
+    storageKey(_location, key, sizeof(key));
+
+    size_t header = 1 + sizeof(_location) + sizeof(_count);
+    size_t len = header + _count * sizeof(Day);
+    uint8_t *blob = (uint8_t *)malloc(len);
+    if (!blob)
+        return;
+    blob[0] = STORE_VERSION;
+    memcpy(blob + 1, _location, sizeof(_location));
+    memcpy(blob + 1 + sizeof(_location), &_count, sizeof(_count));
+    memcpy(blob + header, _days, _count * sizeof(Day));
+    NVSManager::saveBlob(key, blob, len, ns);
+    free(blob);
+}
@@ -0,0 +1,55 @@
+#ifndef INKHISTORYSTORE_H
+#define INKHISTORYSTORE_H
+
+#include <Arduino.h>
+
+#ifndef INK_HISTORY_CAPACITY
+#define INK_HISTORY_CAPACITY 60 // past days kept per location
+#endif
+
+// Past weather for one location, one record per date, kept sorted by date so a
+// lookup is a binary search. Days only ever get added or replaced (past weather
+// does not change); once INK_HISTORY_CAPACITY is reached the oldest day goes.
+//
+// The whole store is one NVS blob per location (about 2.2 KB with the default
+// capacity), so it survives restarts and only missing dates need a request.
+class InkHistoryStore {
+public:
+  struct Day {
+    uint16_t day;     // days since 1970-01-01
+    int16_t avgTemp;  // tenths of a degree
+    char condition[32];
+  };
+
+  InkHistoryStore();
+
+  void reset(const char *location = "");
+  const char *location() const;
+  int size() const;
+  const Day &at(int index) const; // 0 = oldest
+
+  // True when the stored record changed; false for a malformed date, an identical
+  // day, or a day older than everything kept once the store is full
+  bool put(const char *date, float avgTemp, const char *condition);
+  int find(const char *date) const;                                  // -1 if not stored
+  int find(int32_t day) const;
+
+  // First run of missing days inside [from, to]; false when all are present
+  bool gap(int32_t from, int32_t to, int32_t &gapFrom, int32_t &gapTo) const;
+
+  bool load(const char *location, const char *ns); // false (and empty) if nothing was saved
+  void save(const char *ns) const;
+
+  static int32_t dayNumber(const char *date); // "YYYY-MM-DD", -1 if malformed
+  static void formatDay(int32_t day, char *out, size_t size);
+
+private:
+  int lowerBound(int32_t day) const;
+  static void storageKey(const char *location, char *key, size_t size);
+
+  char _location[48];
+  uint16_t _count;
+  Day _days[INK_HISTORY_CAPACITY];
+};
+
+#endif
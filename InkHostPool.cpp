@@ -0,0 +1,142 @@
+#include "InkHostPool.h"
+
+static const float EWMA_ALPHA = 0.2f;
+
+InkHostPool::InkHostPool()
+{
+    reset("");
+}
+
+void InkHostPool::reset(const char *primary)
+{
+    _count = 0;
+    add(primary);
+}
+
+int InkHostPool::size() const
+{
+    return _count;
+}
+
+const InkHostPool::Host &InkHostPool::at(int index) const
+{
+    return _hosts[index];
+}
+
+int InkHostPool::find(const char *url) const
+{
+    for (int i = 0; i < _count; i++)
+        if (strcmp(_hosts[i].url, url) == 0)
+            return i;
+    return -1;
+}
+
+int InkHostPool::add(const char *url)
+{
+    int i = find(url);
+    if (i >= 0)
+        return i;
+    if (_count >= INK_MAX_HOSTS)
+        return -1;
+
+    Host &host = _hosts[_count];
+    memset(&host, 0, sizeof(host));
+    strlcpy(host.url, url, sizeof(host.url));
+    return _count++;
+}
+
+bool InkHostPool::isOpen(int index, uint32_t now) const
+{
+    const Host &host = _hosts[index];
+    return host.openUntil != 0 && (int32_t)(host.openUntil - now) > 0;
+}
+
+// A host whose open period just ended goes first, so one request finds out
+// whether it recovered. A host never tried is taken to be as fast as the best
+// measured one: it loses the tie to that host and takes over once that host
+// shows errors.
+int InkHostPool::pick(uint32_t now) const
+{
+    float neutral = 0;
+    for (int i = 0; i < _count; i++)
+    {
+        if (_hosts[i].latencyMs > 0 && (neutral == 0 || _hosts[i].latencyMs < neutral))
+            neutral = _hosts[i].latencyMs;
+    }
+
+    int best = -1;
+    float bestScore = 0;
+    bool bestUntried = false;
+    for (int i = 0; i < _count; i++)
+    {
+        const Host &host = _hosts[i];
+        if (isOpen(i, now))
+            continue;
+        if (host.openUntil != 0)
+            return i; // trial request
+        bool untried = host.latencyMs == 0 && host.errorRate == 0;
+        float score = untried ? neutral : (1.0f - host.errorRate) * host.latencyMs + host.errorRate * INK_HOST_FAILURE_MS;
+        if (best < 0 || score < bestScore || (score == bestScore && bestUntried && !untried))
+        {
+            best = i;
+            bestScore = score;
+            bestUntried = untried;
+        }
+    }
+    return best;
+}
+
+void InkHostPool::report(int index, bool ok, uint32_t latencyMs, uint32_t now)
+{
+    if (index < 0 || index >= _count)
+        return;
+    Host &host = _hosts[index];
+    host.errorRate += EWMA_ALPHA * ((ok ? 0.0f : 1.0f) - host.errorRate);
+    if (ok)
+    {
+        host.latencyMs = host.latencyMs == 0 ? latencyMs : host.latencyMs + EWMA_ALPHA * (latencyMs - host.latencyMs);
+        host.failures = 0;
+        host.trips = 0;
+        host.openUntil = 0;
+        return;
+    }
+
+    // A failed trial reopens at once; a closed breaker needs a run of failures
+    host.failures++;
+    if (host.openUntil == 0 && host.failures < INK_BREAKER_FAILURES)
+        return;
+
+    // The last healthy host stays closed: failing fast would only turn a blip
+    // into an outage with nowhere else to go
+    bool alternative = false;
+    for (int i = 0; i < _count && !alternative; i++)
+        alternative = i != index && !isOpen(i, now);
+    if (!alternative)
+    {
+        host.failures = INK_BREAKER_FAILURES;
+        host.openUntil = 0;
+        return;
+    }
+    uint32_t openMs = INK_BREAKER_OPEN_MS;
+    for (int i = 0; i < host.trips && openMs < INK_BREAKER_MAX_OPEN_MS; i++)
+        openMs *= 2;
+    if (openMs > INK_BREAKER_MAX_OPEN_MS)
+        openMs = INK_BREAKER_MAX_OPEN_MS;
+    if (host.trips < 255)
+        host.trips++;
+    host.failures = 0;
+    host.openUntil = (now + openMs) | 1; // 0 means closed
+    Serial.printf("[Ink] %s unhealthy, breaker open for %lu s\n", host.url, (unsigned long)(openMs / 1000));
+}
+
+String InkHostPool::extras() const
+{
+    String list;
+    for (int i = 1; i < _count; i++)
+    {
+        if (list.length() > 0)
+            list += '\n';
+        list += _hosts[i].url;
+    }
+    return list;
+}
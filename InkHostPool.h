@@ -0,0 +1,61 @@
+#ifndef INKHOSTPOOL_H
+#define INKHOSTPOOL_H
+
+#include <Arduino.h>
+
+#ifndef INK_MAX_HOSTS
+#define INK_MAX_HOSTS 4 // API base URLs, the primary included
+#endif
+#ifndef INK_HOST_FAILURE_MS
+#define INK_HOST_FAILURE_MS 15000 // what a failed request costs when ranking hosts (the request timeout)
+#endif
+#ifndef INK_BREAKER_FAILURES
+#define INK_BREAKER_FAILURES 3 // consecutive failures that open a host's breaker
+#endif
+#ifndef INK_BREAKER_OPEN_MS
+#define INK_BREAKER_OPEN_MS 30000 // first open period; doubles while trial requests keep failing
+#endif
+#ifndef INK_BREAKER_MAX_OPEN_MS
+#define INK_BREAKER_MAX_OPEN_MS 600000
+#endif
+
+// Health of each API base URL: moving averages (EWMA, alpha 0.2) of response
+// latency and error rate, and a circuit breaker. pick() returns the host with
+// the lowest expected request time, latency blended with INK_HOST_FAILURE_MS by
+// error rate; hosts whose breaker is open are skipped until the open period
+// ends, then get a single trial request. The last host with a closed breaker
+// never opens, since failing fast would leave nowhere to go.
+//
+// Entry 0 is the primary URL. Not thread-safe; InkBridge guards it with its
+// config lock.
+class InkHostPool {
+public:
+  struct Host {
+    char url[96];
+    float latencyMs; // of successful requests, 0 until measured
+    float errorRate; // 0..1
+    uint8_t failures; // consecutive
+    uint8_t trips;    // times the breaker opened since the last success
+    uint32_t openUntil; // millis(), 0 while closed
+  };
+
+  InkHostPool();
+
+  void reset(const char *primary);
+  int size() const;
+  const Host &at(int index) const;
+  int find(const char *url) const;
+  int add(const char *url); // index of the host, -1 when the pool is full
+
+  int pick(uint32_t now) const; // -1 while every breaker is open
+  void report(int index, bool ok, uint32_t latencyMs, uint32_t now);
+  bool isOpen(int index, uint32_t now) const;
+
+  String extras() const; // every URL but the primary, one per line, for NVS
+
+private:
+  Host _hosts[INK_MAX_HOSTS];
+  uint8_t _count;
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "InkIndex.h"
+
+InkIndex::InkIndex()
+{
+    _items = nullptr;
+    _hashes = nullptr;
+    _slots = nullptr;
+    _order = nullptr;
+    _count = 0;
+    _capacity = 0;
+    _key = nullptr;
+    _sortField = nullptr;
+}
+
+InkIndex::~InkIndex()
+{
+    clear();
+}
+
+void InkIndex::clear()
+{
+    delete[] _items;
+    delete[] _hashes;
+    delete[] _slots;
+    delete[] _order;
+    _items = nullptr;
+    _hashes = nullptr;
+    _slots = nullptr;
+    _order = nullptr;
+    _count = 0;
+    _capacity = 0;
+    _sortField = nullptr;
+}
+
+// FNV-1a
+uint32_t InkIndex::hash(const char *s)
+{
+    uint32_t h = 2166136261u;
+    while (*s)
+    {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Canvas ids can arrive as numbers or strings; index both by their text form.
+const char *InkIndex::keyText(JsonVariantConst v, char *buf, size_t size)
+{
+    if (v.is<const char *>())
+        return v.as<const char *>();
+    if (v.is<long long>())
+    {
+        snprintf(buf, size, "%lld", v.as<long long>());
+        return buf;
+    }
+    return "";
+}
+
+void InkIndex::build(JsonArray arr, const char *key)
+{
+    clear();
+    _key = key;
+    size_t n = arr.size();
+    if (n == 0)
+        return;
+    if (n > 0x3FFF)
+        n = 0x3FFF;
+
+    uint16_t capacity = 8;
+    while (capacity < n * 2)
+        capacity <<= 1;
+
+    _items = new JsonObject[n];
+    _hashes = new uint32_t[n];
+    _slots = new uint16_t[capacity];
+    if (!_items || !_hashes || !_slots)
+    {
+        Serial.println("[Ink] Index allocation failed");
+        clear();
+        return;
+    }
+    memset(_slots, 0, capacity * sizeof(uint16_t));
+    _capacity = capacity;
+
+    char buf[24];
+    for (JsonVariant v : arr)
+    {
+        if (_count >= n)
+            break;
+        uint16_t i = _count++;
+        _items[i] = v.as<JsonObject>();
+        _hashes[i] = hash(keyText(_items[i][key], buf, sizeof(buf)));
+
+        uint16_t slot = _hashes[i] & (_capacity - 1);
+        while (_slots[slot] != 0)
+            slot = (slot + 1) & (_capacity - 1);
+        _slots[slot] = i + 1;
+    }
+}
+
+const char *InkIndex::sortText(int index) const
+{
+    return _items[index][_sortField] | "";
+}
+
+void InkIndex::sortBy(const char *field)
+{
+    delete[] _order;
+    _order = nullptr;
+    _sortField = field;
+    if (_count == 0)
+        return;
+
+    _order = new uint16_t[_count];
+    if (!_order)
+        return;
+
+    // Insertion sort: lists are short and usually arrive nearly ordered.
+    for (uint16_t i = 0; i < _count; i++)
+    {
+        const char *value = sortText(i);
+        int j = i;
+        while (j > 0)
+        {
+            const char *prev = sortText(_order[j - 1]);
+            bool after = *value != '\0' && (*prev == '\0' || strcmp(prev, value) > 0);
+            if (!after)
+                break;
+            _order[j] = _order[j - 1];
+            j--;
+        }
+        _order[j] = i;
+    }
+}
+
+int InkIndex::size() const
+{
+    return _count;
+}
+
+JsonObject InkIndex::at(int index) const
+{
+    if (index < 0 || index >= _count)
+        return JsonObject();
+    return _items[index];
+}
+
+JsonObject InkIndex::find(const char *key) const
+{
+    if (_count == 0 || !key)
+        return JsonObject();
+
+    uint32_t h = hash(key);
+    uint16_t slot = h & (_capacity - 1);
+    char buf[24];
+    while (_slots[slot] != 0)
+    {
+        uint16_t i = _slots[slot] - 1;
+        if (_hashes[i] == h && strcmp(keyText(_items[i][_key], buf, sizeof(buf)), key) == 0)
+            return _items[i];
+        slot = (slot + 1) & (_capacity - 1);
+    }
+    return JsonObject();
+}
+
+JsonObject InkIndex::ordered(int rank) const
+{
+    if (!_order || rank < 0 || rank >= _count)
+        return JsonObject();
+    return _items[_order[rank]];
+}
+
+int InkIndex::lowerBound(const char *value) const
+{
+    if (!_order)
+        return 0;
+    int lo = 0, hi = _count;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        const char *v = sortText(_order[mid]);
+        if (*v != '\0' && strcmp(v, value) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
@@ -0,0 +1,43 @@
+#ifndef INKINDEX_H
+#define INKINDEX_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Lookup index over the objects of a JsonArray: O(1) positional access, an
+// open-addressed hash on one key field and an optional ordering by another field.
+// The index points into the document, so rebuild it whenever the document changes.
+class InkIndex {
+public:
+  InkIndex();
+  ~InkIndex();
+
+  void build(JsonArray arr, const char *key);
+  void sortBy(const char *field); // ascending string order, missing values last
+  void clear();
+
+  int size() const;
+  JsonObject at(int index) const;
+  JsonObject find(const char *key) const;
+  JsonObject ordered(int rank) const;
+  int lowerBound(const char *value) const; // first rank whose sort field is >= value
+
+private:
+  InkIndex(const InkIndex &);
+  InkIndex &operator=(const InkIndex &);
+
+  static uint32_t hash(const char *s);
+  static const char *keyText(JsonVariantConst v, char *buf, size_t size);
+  const char *sortText(int index) const;
+
+  JsonObject *_items;
+  uint32_t *_hashes;
+  uint16_t *_slots; // item index + 1, 0 marks an empty slot
+  uint16_t *_order;
+  uint16_t _count;
+  uint16_t _capacity;
+  const char *_key;
+  const char *_sortField;
+};
+
+#endif
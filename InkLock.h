@@ -0,0 +1,27 @@
+#ifndef INKLOCK_H
+#define INKLOCK_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Scoped hold on a recursive FreeRTOS mutex. A null handle is a no-op, so
+// objects constructed before the scheduler runs stay usable.
+class InkLock {
+public:
+  explicit InkLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+    if (_mutex) xSemaphoreTakeRecursive(_mutex, portMAX_DELAY);
+  }
+  InkLock(InkLock &&other) : _mutex(other._mutex) { other._mutex = nullptr; }
+  ~InkLock() {
+    if (_mutex) xSemaphoreGiveRecursive(_mutex);
+  }
+
+private:
+  InkLock(const InkLock &);
+  InkLock &operator=(const InkLock &);
+
+  SemaphoreHandle_t _mutex;
+};
+
+#endif
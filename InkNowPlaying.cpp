@@ -0,0 +1,83 @@
+#include "InkNowPlaying.h"
+
+InkNowPlaying::InkNowPlaying()
+{
+    reset();
+}
+
+void InkNowPlaying::reset()
+{
+    memset(&_state, 0, sizeof(_state));
+    _anchorAt = _syncedAt = _attemptAt = _commandAt = 0;
+    _attempted = _pending = false;
+}
+
+void InkNowPlaying::sync(bool playing, uint32_t progressMs, uint32_t durationMs, const char *title, const char *artist,
+                         const char *uri, uint32_t now)
+{
+    _state.valid = true;
+    _state.playing = playing;
+    _state.positionMs = durationMs > 0 && progressMs > durationMs ? durationMs : progressMs;
+    _state.durationMs = durationMs;
+    strlcpy(_state.title, title ? title : "", sizeof(_state.title));
+    strlcpy(_state.artist, artist ? artist : "", sizeof(_state.artist));
+    strlcpy(_state.uri, uri ? uri : "", sizeof(_state.uri));
+    _anchorAt = _syncedAt = now;
+    _pending = false;
+}
+
+void InkNowPlaying::attempted(uint32_t now)
+{
+    _attemptAt = now;
+    _attempted = true;
+}
+
+// Shows the command's expected effect until the server confirms it. Volume
+// does not move the position, so it needs no read-back.
+void InkNowPlaying::apply(const char *action, int32_t positionMs, uint32_t now)
+{
+    if (strcmp(action, "volume") == 0)
+        return;
+
+    uint32_t at = position(now);
+    if (strcmp(action, "pause") == 0)
+        _state.playing = false;
+    else if (strcmp(action, "play") == 0)
+        _state.playing = true;
+    else if (strcmp(action, "seek") == 0 && positionMs >= 0)
+        at = _state.durationMs > 0 && (uint32_t)positionMs > _state.durationMs ? _state.durationMs : positionMs;
+    else if (strcmp(action, "next") == 0 || strcmp(action, "previous") == 0)
+        at = 0; // the new track's length is unknown until the read-back
+    _state.positionMs = at;
+    _anchorAt = now;
+    _commandAt = now;
+    _pending = true;
+}
+
+bool InkNowPlaying::needsSync(uint32_t now, uint32_t driftMs) const
+{
+    if (_attempted && now - _attemptAt < INK_NOW_PLAYING_MIN_MS)
+        return false;
+    if (!_state.valid)
+        return true;
+    if (_pending)
+        return now - _commandAt >= INK_NOW_PLAYING_SETTLE_MS;
+    if (_state.playing && _state.durationMs > 0 && position(now) >= _state.durationMs)
+        return true; // track over, the next one has started
+    return now - _syncedAt >= driftMs;
+}
+
+uint32_t InkNowPlaying::position(uint32_t now) const
+{
+    if (!_state.playing)
+        return _state.positionMs;
+    uint32_t at = _state.positionMs + (now - _anchorAt);
+    return _state.durationMs > 0 && at > _state.durationMs ? _state.durationMs : at;
+}
+
+InkTrackState InkNowPlaying::state(uint32_t now) const
+{
+    InkTrackState out = _state;
+    out.positionMs = position(now);
+    return out;
+}
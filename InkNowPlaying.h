@@ -0,0 +1,59 @@
+#ifndef INKNOWPLAYING_H
+#define INKNOWPLAYING_H
+
+#include <Arduino.h>
+
+#ifndef INK_NOW_PLAYING_DRIFT_MS
+#define INK_NOW_PLAYING_DRIFT_MS 30000 // longest time between re-syncs, see setNowPlayingDrift
+#endif
+#ifndef INK_NOW_PLAYING_SETTLE_MS
+#define INK_NOW_PLAYING_SETTLE_MS 1000 // wait after a local command before reading it back
+#endif
+#ifndef INK_NOW_PLAYING_MIN_MS
+#define INK_NOW_PLAYING_MIN_MS 2000 // shortest time between server reads, failed ones included
+#endif
+
+// Snapshot of the player, see InkBridge::getNowPlaying
+struct InkTrackState {
+  bool valid; // false until the first successful read
+  bool playing;
+  uint32_t positionMs; // interpolated
+  uint32_t durationMs; // 0 when nothing is playing
+  char title[64];
+  char artist[64];
+  char uri[64];
+};
+
+// Spotify playback position between server reads. sync() stores progress_ms,
+// duration_ms and is_playing with the millis() they were read at; while
+// playing, position() adds the time since. needsSync() asks for the next read
+// only when the estimate can no longer be trusted: at the end of the track,
+// INK_NOW_PLAYING_SETTLE_MS after a local command (whose effect apply() shows
+// in the meantime), or once the drift interval has passed.
+//
+// Not thread-safe; InkBridge guards it with the Spotify lock.
+class InkNowPlaying {
+public:
+  InkNowPlaying();
+
+  void reset();
+  void sync(bool playing, uint32_t progressMs, uint32_t durationMs, const char *title, const char *artist,
+            const char *uri, uint32_t now);
+  void attempted(uint32_t now); // a read was started, successful or not
+  void apply(const char *action, int32_t positionMs, uint32_t now);
+
+  bool needsSync(uint32_t now, uint32_t driftMs) const;
+  uint32_t position(uint32_t now) const;
+  InkTrackState state(uint32_t now) const;
+
+private:
+  InkTrackState _state; // positionMs is the value at _anchorAt
+  uint32_t _anchorAt;
+  uint32_t _syncedAt;
+  uint32_t _attemptAt;
+  uint32_t _commandAt;
+  bool _attempted;
+  bool _pending; // a local command has not been read back yet
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "InkPool.h"
+
+static const size_t BLOCK_SIZES[INK_POOL_CLASSES] = {INK_POOL_SMALL, INK_POOL_MEDIUM, INK_POOL_LARGE};
+// Share of the arena per block size, in quarters
+static const size_t BLOCK_SHARES[INK_POOL_CLASSES] = {1, 1, 2};
+
+InkPool::InkPool()
+{
+    _arena = nullptr;
+    _lock = nullptr;
+    _capacity = _used = _peak = _fallbacks = 0;
+    for (int c = 0; c < INK_POOL_CLASSES; c++)
+    {
+        _start[c] = _end[c] = nullptr;
+        _free[c] = nullptr;
+    }
+}
+
+InkPool &InkPool::shared()
+{
+    static InkPool pool;
+    return pool;
+}
+
+bool InkPool::reserve(size_t bytes)
+{
+    if (_arena)
+        return true;
+    uint8_t *arena = (uint8_t *)malloc(bytes);
+    if (!arena)
+        return false;
+    SemaphoreHandle_t lock = xSemaphoreCreateRecursiveMutex();
+    if (!lock)
+    {
+        free(arena);
+        return false;
+    }
+
+    uint8_t *next = arena;
+    for (int c = 0; c < INK_POOL_CLASSES; c++)
+    {
+        size_t count = bytes * BLOCK_SHARES[c] / 4 / BLOCK_SIZES[c];
+        _start[c] = next;
+        for (size_t i = 0; i < count; i++)
+        {
+            Block *block = (Block *)(next + i * BLOCK_SIZES[c]);
+            block->next = _free[c];
+            _free[c] = block;
+        }
+        next += count * BLOCK_SIZES[c];
+        _end[c] = next;
+    }
+    _capacity = next - arena;
+    _lock = lock;
+    _arena = arena; // published last: allocations before this went to the heap
+    return true;
+}
+
+bool InkPool::reserved() const
+{
+    return _arena != nullptr;
+}
+
+InkPoolStats InkPool::stats() const
+{
+    InkLock lock(_lock);
+    InkPoolStats out = {};
+    out.capacity = _capacity;
+    out.used = _used;
+    out.peak = _peak;
+    out.fallbacks = _fallbacks;
+    return out;
+}
+
+int InkPool::classOf(const void *pointer) const
+{
+    const uint8_t *p = (const uint8_t *)pointer;
+    for (int c = 0; _arena && c < INK_POOL_CLASSES; c++)
+    {
+        if (p >= _start[c] && p < _end[c])
+            return c;
+    }
+    return -1;
+}
+
+// Smallest free block that fits, caller holds the lock
+void *InkPool::take(size_t size)
+{
+    for (int c = 0; c < INK_POOL_CLASSES; c++)
+    {
+        if (size > BLOCK_SIZES[c] || !_free[c])
+            continue;
+        Block *block = _free[c];
+        _free[c] = block->next;
+        _used += BLOCK_SIZES[c];
+        if (_used > _peak)
+            _peak = _used;
+        return block;
+    }
+    return nullptr;
+}
+
+void *InkPool::allocate(size_t size)
+{
+    if (!_arena)
+        return malloc(size);
+    InkLock lock(_lock);
+    void *block = take(size);
+    if (block)
+        return block;
+    _fallbacks++;
+    return malloc(size);
+}
+
+void InkPool::deallocate(void *pointer)
+{
+    int c = classOf(pointer);
+    if (c < 0)
+    {
+        free(pointer);
+        return;
+    }
+    InkLock lock(_lock);
+    Block *block = (Block *)pointer;
+    block->next = _free[c];
+    _free[c] = block;
+    _used -= BLOCK_SIZES[c];
+}
+
+// Blocks do not shrink; growing past the block moves the contents.
+void *InkPool::reallocate(void *pointer, size_t newSize)
+{
+    if (!pointer)
+        return allocate(newSize);
+    int c = classOf(pointer);
+    if (c < 0)
+        return realloc(pointer, newSize);
+    if (newSize <= BLOCK_SIZES[c])
+        return pointer;
+    void *moved = allocate(newSize);
+    if (!moved)
+        return nullptr;
+    memcpy(moved, pointer, BLOCK_SIZES[c]);
+    deallocate(pointer);
+    return moved;
+}
@@ -0,0 +1,114 @@
+#ifndef INKPOOL_H
+#define INKPOOL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "InkLock.h"
+
+#ifndef INK_POOL_BYTES
+#define INK_POOL_BYTES 24576 // arena reserved for JsonDocuments in steady-state mode
+#endif
+
+// Block sizes of the arena. ArduinoJson asks for short strings, the small
+// array listing its slot pools, and 1 KB slot pools on 32-bit targets.
+#define INK_POOL_CLASSES 3
+#define INK_POOL_SMALL 32
+#define INK_POOL_MEDIUM 128
+#define INK_POOL_LARGE 1024
+
+struct InkPoolStats {
+  uint32_t capacity;  // arena bytes, 0 until reserved
+  uint32_t used;      // bytes in handed-out blocks
+  uint32_t peak;
+  uint32_t fallbacks; // allocations that went to the heap because no block fit
+  uint32_t connectionMisses; // requests that had to allocate their client objects, see InkBridge
+};
+
+// ArduinoJson allocator over one arena carved into fixed-size blocks at
+// reserve(). Each block size has its own free list, so blocks never split or
+// merge and a long-running device cannot fragment the arena; a request that
+// does not fit any free block goes to the heap and is counted. Until reserve()
+// is called every call goes straight to malloc/free.
+//
+// Response documents use shared() by default, so caches and in-flight replies
+// of every InkBridge instance draw from the same arena.
+class InkPool : public ArduinoJson::Allocator {
+public:
+  InkPool();
+
+  static InkPool &shared();
+
+  bool reserve(size_t bytes); // once; false if the arena could not be allocated
+  bool reserved() const;
+  InkPoolStats stats() const;
+
+  void *allocate(size_t size) override;
+  void deallocate(void *pointer) override;
+  void *reallocate(void *pointer, size_t newSize) override;
+
+private:
+  struct Block {
+    Block *next;
+  };
+
+  int classOf(const void *pointer) const; // -1 for heap pointers
+  void *take(size_t size);
+
+  uint8_t *_arena;
+  uint8_t *_start[INK_POOL_CLASSES];
+  uint8_t *_end[INK_POOL_CLASSES];
+  Block *_free[INK_POOL_CLASSES];
+  SemaphoreHandle_t _lock;
+  uint32_t _capacity;
+  uint32_t _used;
+  uint32_t _peak;
+  uint32_t _fallbacks;
+};
+
+// N objects created once by reserve() and handed out again and again. take()
+// falls back to new when all are in use, so callers never fail; give() returns
+// pooled objects and deletes the others. Not thread-safe; InkBridge guards its
+// pools with the config lock.
+template <typename T, int N> class InkObjectPool {
+public:
+  InkObjectPool() : _items(nullptr), _busy(0), _misses(0) {}
+  ~InkObjectPool() { delete[] _items; }
+
+  bool reserve() {
+    if (!_items) _items = new T[N];
+    return _items != nullptr;
+  }
+
+  T *take() {
+    for (int i = 0; _items && i < N; i++) {
+      if (!(_busy & (1u << i))) {
+        _busy |= 1u << i;
+        return &_items[i];
+      }
+    }
+    if (_items) _misses++;
+    return new T();
+  }
+
+  // True when item was one of the reserved objects
+  bool give(T *item) {
+    if (_items && item >= _items && item < _items + N) {
+      _busy &= ~(1u << (item - _items));
+      return true;
+    }
+    delete item;
+    return false;
+  }
+
+  uint32_t misses() const { return _misses; }
+
+private:
+  InkObjectPool(const InkObjectPool &);
+  InkObjectPool &operator=(const InkObjectPool &);
+
+  T *_items;
+  uint32_t _busy;
+  uint32_t _misses;
+};
+
+#endif
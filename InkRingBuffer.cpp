@@ -0,0 +1,87 @@
+#include "InkRingBuffer.h"
+
+InkRingBuffer::InkRingBuffer() : _buffer(nullptr), _mask(0), _head(0), _tail(0), _closed(false)
+{
+}
+
+InkRingBuffer::~InkRingBuffer()
+{
+    delete[] _buffer;
+}
+
+bool InkRingBuffer::allocate(size_t capacity)
+{
+    size_t size = 64;
+    while (size < capacity)
+        size <<= 1;
+    delete[] _buffer;
+    _buffer = new uint8_t[size];
+    _mask = _buffer ? size - 1 : 0;
+    reset();
+    return _buffer != nullptr;
+}
+
+void InkRingBuffer::reset()
+{
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+    _closed.store(false, std::memory_order_release);
+}
+
+size_t InkRingBuffer::space() const
+{
+    if (!_buffer)
+        return 0;
+    return _mask + 1 - (_head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_acquire));
+}
+
+size_t InkRingBuffer::available() const
+{
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_relaxed);
+}
+
+size_t InkRingBuffer::write(const uint8_t *data, size_t len)
+{
+    size_t head = _head.load(std::memory_order_relaxed);
+    size_t free = space();
+    if (len > free)
+        len = free;
+
+    size_t offset = head & _mask;
+    size_t first = _mask + 1 - offset;
+    if (first > len)
+        first = len;
+    memcpy(_buffer + offset, data, first);
+    memcpy(_buffer, data + first, len - first);
+
+    _head.store(head + len, std::memory_order_release);
+    return len;
+}
+
+void InkRingBuffer::close()
+{
+    _closed.store(true, std::memory_order_release);
+}
+
+size_t InkRingBuffer::read(uint8_t *data, size_t len)
+{
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    size_t ready = available();
+    if (len > ready)
+        len = ready;
+
+    size_t offset = tail & _mask;
+    size_t first = _mask + 1 - offset;
+    if (first > len)
+        first = len;
+    memcpy(data, _buffer + offset, first);
+    memcpy(data + first, _buffer, len - first);
+
+    _tail.store(tail + len, std::memory_order_release);
+    return len;
+}
+
+bool InkRingBuffer::finished() const
+{
+    return _closed.load(std::memory_order_acquire) && available() == 0;
+}
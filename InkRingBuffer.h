@@ -0,0 +1,39 @@
+#ifndef INKRINGBUFFER_H
+#define INKRINGBUFFER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer byte ring. One task may write and
+// one other task may read concurrently without further locking. Capacity is
+// rounded up to a power of two.
+class InkRingBuffer {
+public:
+  InkRingBuffer();
+  ~InkRingBuffer();
+
+  bool allocate(size_t capacity);
+  void reset(); // only while neither side is active
+
+  // Producer side
+  size_t write(const uint8_t *data, size_t len); // returns bytes accepted, may be short
+  size_t space() const;
+  void close(); // end of stream
+
+  // Consumer side
+  size_t read(uint8_t *data, size_t len); // returns bytes copied, may be short
+  size_t available() const;
+  bool finished() const; // closed and drained
+
+private:
+  InkRingBuffer(const InkRingBuffer &);
+  InkRingBuffer &operator=(const InkRingBuffer &);
+
+  uint8_t *_buffer;
+  size_t _mask;
+  std::atomic<size_t> _head; // total bytes written
+  std::atomic<size_t> _tail; // total bytes read
+  std::atomic<bool> _closed;
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "InkTimeSeries.h"
+
+static const int32_t UNIT_LIMIT = 0x3FFFFFFF;
+
+InkTimeSeries::InkTimeSeries()
+{
+    reset();
+}
+
+void InkTimeSeries::reset(const char *symbol)
+{
+    strlcpy(_symbol, symbol ? symbol : "", sizeof(_symbol));
+    _first = 0;
+    _last = 0;
+    _lastTime = 0;
+    _head = 0;
+    _count = 0;
+    _decimals = 0;
+    _shift = 0;
+}
+
+double InkTimeSeries::toValue(int32_t units) const
+{
+    return ldexp((double)units, _shift) / pow(10.0, _decimals);
+}
+
+int64_t InkTimeSeries::toUnits(double value) const
+{
+    return llround(ldexp(value * pow(10.0, _decimals), -_shift));
+}
+
+// Halves the resolution of every stored sample so larger steps fit in 16 bits.
+void InkTimeSeries::coarsen()
+{
+    int32_t prevOld = _first;
+    int32_t prevNew = (_first + 1) >> 1;
+    _first = prevNew;
+    for (int i = 1; i < _count; i++)
+    {
+        int idx = (_head + i) % INK_SERIES_CAPACITY;
+        int32_t cur = prevOld + _deltas[idx];
+        int32_t curNew = (cur + 1) >> 1;
+        _deltas[idx] = (int16_t)(curNew - prevNew);
+        prevOld = cur;
+        prevNew = curNew;
+    }
+    _last = prevNew;
+    _shift++;
+}
+
+bool InkTimeSeries::append(uint32_t time, double value)
+{
+    if (isnan(value))
+        return false;
+    if (_count > 0 && time != 0 && time <= _lastTime)
+        return false;
+
+    if (_count == 0)
+    {
+        // Finest decimal grid that still leaves headroom in 32 bits
+        _shift = 0;
+        _decimals = 9;
+        while (_decimals > 0 && fabs(value) * pow(10.0, _decimals) > UNIT_LIMIT / 4)
+            _decimals--;
+        int64_t units = toUnits(value);
+        while (units > UNIT_LIMIT || units < -UNIT_LIMIT)
+        {
+            _shift++;
+            units = toUnits(value);
+        }
+        _first = _last = (int32_t)units;
+        _head = 0;
+        _count = 1;
+        _lastTime = time;
+        return true;
+    }
+
+    int64_t units = toUnits(value);
+    while (units > UNIT_LIMIT || units < -UNIT_LIMIT || units - _last > INT16_MAX || units - _last < INT16_MIN)
+    {
+        coarsen();
+        units = toUnits(value);
+    }
+
+    if (_count == INK_SERIES_CAPACITY)
+    {
+        _head = (_head + 1) % INK_SERIES_CAPACITY;
+        _first += _deltas[_head];
+        _count--;
+    }
+
+    int idx = (_head + _count) % INK_SERIES_CAPACITY;
+    _deltas[idx] = (int16_t)(units - _last);
+    _last = (int32_t)units;
+    _count++;
+    _lastTime = time;
+    return true;
+}
+
+const char *InkTimeSeries::symbol() const
+{
+    return _symbol;
+}
+
+int InkTimeSeries::size() const
+{
+    return _count;
+}
+
+uint32_t InkTimeSeries::lastTime() const
+{
+    return _lastTime;
+}
+
+double InkTimeSeries::latest() const
+{
+    return _count == 0 ? 0.0 : toValue(_last);
+}
+
+double InkTimeSeries::valueAt(int index) const
+{
+    if (index < 0 || index >= _count)
+        return 0.0;
+    int32_t units = _first;
+    for (int i = 1; i <= index; i++)
+        units += _deltas[(_head + i) % INK_SERIES_CAPACITY];
+    return toValue(units);
+}
+
+double InkTimeSeries::minValue() const
+{
+    if (_count == 0)
+        return 0.0;
+    int32_t units = _first, lo = _first;
+    for (int i = 1; i < _count; i++)
+    {
+        units += _deltas[(_head + i) % INK_SERIES_CAPACITY];
+        if (units < lo)
+            lo = units;
+    }
+    return toValue(lo);
+}
+
+double InkTimeSeries::maxValue() const
+{
+    if (_count == 0)
+        return 0.0;
+    int32_t units = _first, hi = _first;
+    for (int i = 1; i < _count; i++)
+    {
+        units += _deltas[(_head + i) % INK_SERIES_CAPACITY];
+        if (units > hi)
+            hi = units;
+    }
+    return toValue(hi);
+}
+
+int InkTimeSeries::decimate(int width, float *mins, float *maxs) const
+{
+    if (width <= 0 || _count == 0 || !mins || !maxs)
+        return 0;
+    int columns = _count < width ? _count : width;
+
+    int32_t units = _first;
+    int sample = 0;
+    for (int col = 0; col < columns; col++)
+    {
+        int end = (int)(((long)(col + 1) * _count) / columns);
+        int32_t lo = INT32_MAX, hi = INT32_MIN;
+        for (; sample < end; sample++)
+        {
+            if (sample > 0)
+                units += _deltas[(_head + sample) % INK_SERIES_CAPACITY];
+            if (units < lo)
+                lo = units;
+            if (units > hi)
+                hi = units;
+        }
+        mins[col] = toValue(lo);
+        maxs[col] = toValue(hi);
+    }
+    return columns;
+}
@@ -0,0 +1,53 @@
+#ifndef INKTIMESERIES_H
+#define INKTIMESERIES_H
+
+#include <Arduino.h>
+
+#ifndef INK_SERIES_CAPACITY
+#define INK_SERIES_CAPACITY 120 // samples kept per symbol
+#endif
+
+// Bounded price history for one symbol. Samples sit on a fixed-point grid
+// (value = units * 2^shift / 10^decimals) and are stored as 16-bit deltas in a
+// ring buffer; the oldest sample is dropped once INK_SERIES_CAPACITY is reached.
+// If a jump does not fit in 16 bits the grid is coarsened for the whole series.
+//
+// Memory per symbol: 2 * INK_SERIES_CAPACITY bytes of deltas plus a 32-byte
+// header (272 bytes with the default capacity), independent of how often it is updated.
+class InkTimeSeries {
+public:
+  InkTimeSeries();
+
+  void reset(const char *symbol = "");
+  bool append(uint32_t time, double value); // ignored unless time is newer than lastTime()
+
+  const char *symbol() const;
+  int size() const;
+  uint32_t lastTime() const;
+  double latest() const;
+  double valueAt(int index) const; // 0 = oldest, walks the deltas
+  double minValue() const;
+  double maxValue() const;
+
+  // Reduces the series to at most width columns for charting. Each column gets
+  // the min and max of the samples it covers, so spikes survive decimation.
+  // Returns the number of columns written.
+  int decimate(int width, float *mins, float *maxs) const;
+
+private:
+  double toValue(int32_t units) const;
+  int64_t toUnits(double value) const;
+  void coarsen();
+
+  char _symbol[12];
+  int32_t _first; // absolute units of the oldest sample
+  int32_t _last;  // absolute units of the newest sample
+  uint32_t _lastTime;
+  uint16_t _head;
+  uint16_t _count;
+  int8_t _decimals;
+  uint8_t _shift;
+  int16_t _deltas[INK_SERIES_CAPACITY]; // _deltas[i] = units[i] - units[i - 1]
+};
+
+#endif
@@ -11,6 +11,7 @@ InkBridge::InkBridge()
     _deviceId = "";
     _uid = "";
     _resetDevice = false;
+    initState();
 }
 
 InkBridge::InkBridge(bool resetDevice)
@@ -21,6 +22,7 @@ InkBridge::InkBridge(bool resetDevice)
     _deviceId = "";
     _uid = "";
     _resetDevice = resetDevice;
+    initState();
 }
 
 InkBridge::InkBridge(const char *apiUrl)
@@ -31,10 +33,156 @@ InkBridge::InkBridge(const char *apiUrl)
     _deviceId = "";
     _uid = "";
     _resetDevice = false;
+    initState();
+}
+
+// Shared by all constructors
+void InkBridge::initState()
+{
+    for (int i = 0; i < INK_SOURCE_COUNT; i++)
+        _locks[i] = xSemaphoreCreateRecursiveMutex();
+    _decodeOnce = false;
+    _registerJitterMs = INK_REGISTER_JITTER_MS;
+    _pollJitterPercent = INK_POLL_JITTER_PERCENT;
+    _bytesSent = _bytesReceived = 0;
+    _parseQueue = _resultQueue = nullptr;
+    _parseDone = _jobSignal = _pipeStopped = nullptr;
+    _activeRequests = 0;
+    _bucketCount = 0;
+    _defaultPerMinute = INK_RATE_PER_MINUTE;
+    _defaultBurst = INK_RATE_BURST;
+    for (int i = 0; i < INK_PRIORITY_COUNT; i++)
+    {
+        _jobQueue[i] = nullptr;
+        _waitingRequests[i] = 0;
+        _waitCount[i] = _waitMaxUs[i] = 0;
+        _waitTotalUs[i] = 0;
+    }
+    _netTask = _parseTask = nullptr;
+    _hosts.reset(_apiUrl.c_str());
+    _prewarmEnabled = true;
+    _prewarmTask = nullptr;
+    _warmClient = nullptr;
+    _warmAt = 0;
+    _dnsAt = 0;
+    _wifiEvent = 0;
+    _steadyState = false;
+    _deadlineMs = 0;
+    for (int i = 0; i < INK_MAX_DEADLINES; i++)
+        _deadlines[i].task = nullptr;
+    for (int i = 0; i < 2; i++)
+    {
+        _statCount[i] = 0;
+        _statLatencyUs[i] = _statParseUs[i] = 0;
+    }
+#if INK_ENABLE_WEATHER
+    _siteCount = _siteNext = 0;
+    _historyLoaded = false;
+    _historyProbeNext = 0;
+    for (int i = 0; i < INK_HISTORY_PROBES; i++)
+        _historyProbes[i].used = false;
+    _localAstronomy = true;
+#endif
+#if INK_ENABLE_NEWS || INK_ENABLE_CALENDAR
+    _deltaSync = false;
+#endif
+#if INK_ENABLE_STOCKS
+    _stockSeriesNext = 0;
+#endif
+#if INK_ENABLE_CRYPTO
+    _cryptoSeriesNext = 0;
+#endif
+#if INK_ENABLE_SPOTIFY
+    _journalEnabled = true;
+    _replaying = false;
+    _replayTask = nullptr;
+    _nowPlayingDriftMs = INK_NOW_PLAYING_DRIFT_MS;
+#endif
+#if INK_ENABLE_CANVAS
+    _gradeCodes = nullptr;
+    _gradeCodeCount = 0;
+    _gpaValid[0] = _gpaValid[1] = false;
+    _gpaRevision = 0;
+#endif
+}
+
+InkBridge::~InkBridge()
+{
+    endPipeline();
+    if (_wifiEvent)
+        WiFi.removeEvent(_wifiEvent);
+    dropClient(takeWarmClient(-1)); // waits for a running pre-warm
+#if INK_ENABLE_SPOTIFY
+    for (;;)
+    {
+        {
+            InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+            if (!_replayTask)
+                break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+#endif
+#if INK_ENABLE_CANVAS
+    delete[] _gradeCodes;
+#endif
+    for (int i = 0; i < INK_SOURCE_COUNT; i++)
+    {
+        if (_locks[i])
+            vSemaphoreDelete(_locks[i]);
+    }
+}
+
+InkLock InkBridge::lockSource(InkSource source)
+{
+    return InkLock(_locks[source]);
+}
+
+bool InkBridge::missing(InkSource source, const Response &response, const bool *decoded)
+{
+    InkLock lock(_locks[source]);
+    return !(decoded && *decoded) && response.data.isNull();
+}
+
+// Requests that were never sent keep the cached data; only the status changes.
+bool InkBridge::keepsCache(const Response &fresh)
+{
+    return fresh.status == "RATE_LIMITED" || fresh.status == "HOST_UNAVAILABLE" || fresh.status == "DEADLINE_EXCEEDED";
+}
+
+// Swaps a finished response into its cache slot. Readers only ever wait for this
+// swap, never for the request that produced it.
+Response InkBridge::store(InkSource source, Response &target, Response &&fresh)
+{
+    InkLock lock(_locks[source]);
+    if (keepsCache(fresh))
+        target.status = fresh.status;
+    else
+        target = std::move(fresh);
+    return target;
+}
+
+void InkBridge::identify(JsonDocument &doc)
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    doc["uid"] = _uid;
+    doc["device_id"] = _deviceId;
 }
 
 bool InkBridge::begin()
 {
+    // Reserve first, while the heap is still in one piece
+    if (_steadyState)
+    {
+        if (!InkPool::shared().reserve(INK_POOL_BYTES))
+            Serial.println("[Ink] Document arena allocation failed, documents use the heap");
+        InkLock lock(_locks[INK_SOURCE_CONFIG]);
+        if (!_clientPool.reserve() || !_httpPool.reserve())
+            Serial.println("[Ink] Client reservation failed, requests allocate their own");
+        _heap.reset();
+        _heap.record(InkHeapMonitor::read(millis()));
+    }
+
     if (!NVSManager::isInit())
     {
         NVSManager::init();
@@ -44,66 +192,147 @@ bool InkBridge::begin()
     if (_resetDevice)
     {
         Serial.println("[Ink] Resetting device configuration as requested...");
-        NVSManager::factoryReset();
+        if (storage())
+            NVSManager::eraseNamespace(storage());
+        else
+            NVSManager::factoryReset();
     }
 
-    String storedDeviceId = NVSManager::loadDeviceId();
-    String storedUID = NVSManager::loadUID();
-    String storedApi = NVSManager::loadApi();
-    String storedUrl = NVSManager::loadApiUrl();
-    String storedFriendly = NVSManager::loadFriendlyUser();
+    String storedDeviceId = NVSManager::loadDeviceId(storage());
+    String storedUID = NVSManager::loadUID(storage());
+    String storedApi = NVSManager::loadApi(storage());
+    String storedUrl = NVSManager::loadApiUrl(storage());
+    String storedFriendly = NVSManager::loadFriendlyUser(storage());
+    String storedHosts = NVSManager::loadApiHosts(storage());
 
-    if (storedDeviceId.length() == 0 || storedDeviceId == "null")
+    bool needsRegistration;
     {
-        bool connected = (WiFi.status() == WL_CONNECTED) ||
-                         (WiFi.localIP() != INADDR_NONE && WiFi.localIP()[0] != 0);
-
-        if (connected)
+        InkLock lock(_locks[INK_SOURCE_CONFIG]);
+        if (storedDeviceId.length() == 0 || storedDeviceId == "null")
         {
-            String mac = WiFi.macAddress();
-            mac.replace(":", "");
-            _deviceId = mac;
-            Serial.println("[Ink] New Device ID detected: " + _deviceId);
-            NVSManager::saveDeviceId(_deviceId);
-            Serial.println("[Ink] Device ID Saved");
+            bool connected = (WiFi.status() == WL_CONNECTED) ||
+                             (WiFi.localIP() != INADDR_NONE && WiFi.localIP()[0] != 0);
+
+            if (connected)
+            {
+                String mac = _deviceMac.length() > 0 ? _deviceMac : WiFi.macAddress();
+                mac.replace(":", "");
+                _deviceId = mac;
+                Serial.println("[Ink] New Device ID detected: " + _deviceId);
+                NVSManager::saveDeviceId(_deviceId, storage());
+                Serial.println("[Ink] Device ID Saved");
+            }
+            else
+            {
+                Serial.println("[Error] WiFi needed to generate Device ID");
+                return false;
+            }
         }
         else
         {
-            Serial.println("[Error] WiFi needed to generate Device ID");
-            return false;
+            _deviceId = storedDeviceId;
+            Serial.println("[Ink] Loaded Device ID from NVS(Non-Volotile Storage): " + _deviceId);
         }
-    }
-    else
-    {
-        _deviceId = storedDeviceId;
-        Serial.println("[Ink] Loaded Device ID from NVS(Non-Volotile Storage): " + _deviceId);
-    }
 
-    if (storedApi.length() > 0 && storedApi != "null")
-        _apiKey = storedApi;
+        if (storedApi.length() > 0 && storedApi != "null")
+            _apiKey = storedApi;
+
+        Serial.println("[Ink] API Key loaded from storage.");
+
+        if (storedFriendly.length() > 0 && storedFriendly != "null")
+            _friendlyName = storedFriendly;
+
+        if (storedUID.length() > 0 && storedUID != "null")
+            _uid = storedUID;
 
-    Serial.println("[Ink] API Key loaded from storage.");
+        if (storedUrl.length() > 0 && storedUrl != "null")
+            _apiUrl = storedUrl;
 
-    if (storedFriendly.length() > 0 && storedFriendly != "null")
-        _friendlyName = storedFriendly;
+        // Primary first, then the saved failover hosts, then any added before begin()
+        String added = _hosts.extras();
+        _hosts.reset(_apiUrl.c_str());
+        String all = storedHosts + "\n" + added;
+        for (int start = 0; start < (int)all.length();)
+        {
+            int end = all.indexOf('\n', start);
+            if (end < 0)
+                end = all.length();
+            String url = all.substring(start, end);
+            url.trim();
+            if (url.length() > 0)
+                _hosts.add(url.c_str());
+            start = end + 1;
+        }
+        if (_hosts.extras() != storedHosts)
+            NVSManager::saveApiHosts(_hosts.extras(), storage());
+
+        needsRegistration = _deviceId.length() > 0 && _apiKey.length() == 0;
+    }
 
-    if (storedUID.length() > 0 && storedUID != "null")
-        _uid = storedUID;
+#if INK_ENABLE_SPOTIFY
+    {
+        InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+        if (_journal.load(storage()) && _journal.size() > 0)
+            Serial.printf("[Ink] %d queued playback commands restored\n", _journal.size());
+    }
+#endif
 
-    if (storedUrl.length() > 0 && storedUrl != "null")
-        _apiUrl = storedUrl;
+    // Warm up (and replay queued commands) now and again whenever the station gets an address
+    if (!_wifiEvent)
+        _wifiEvent = WiFi.onEvent([this](arduino_event_id_t, WiFiEventInfo_t) { onConnected(); }, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    if (WiFi.status() == WL_CONNECTED)
+        onConnected();
 
-    if (_deviceId.length() > 0 && _apiKey.length() == 0)
+    if (needsRegistration)
     {
         Serial.println("[Ink] Device not registered. Attempting auto-registration...");
+        if (_registerJitterMs > 0)
+        {
+            // Spread a fleet rebooting together (e.g. after a power cut) over the window
+            uint32_t wait = esp_random() % _registerJitterMs;
+            Serial.printf("[Ink] Registration jitter %lu ms\n", (unsigned long)wait);
+            delay(wait);
+        }
         return registerDevice();
     }
 
     return isRegistered();
 }
 
+const char *InkBridge::storage()
+{
+    return _nvsNamespace.length() > 0 ? _nvsNamespace.c_str() : nullptr;
+}
+
+void InkBridge::setStorageNamespace(String ns)
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _nvsNamespace = ns.substring(0, 15); // NVS key length limit
+}
+
+void InkBridge::setDeviceMac(String mac)
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _deviceMac = mac;
+}
+
+void InkBridge::setJitter(uint32_t registerMs, uint8_t pollPercent)
+{
+    _registerJitterMs = registerMs;
+    _pollJitterPercent = pollPercent > 100 ? 100 : pollPercent;
+}
+
+uint32_t InkBridge::pollInterval(uint32_t intervalMs)
+{
+    uint32_t spread = (uint64_t)intervalMs * _pollJitterPercent / 100;
+    if (spread == 0)
+        return intervalMs;
+    return intervalMs - spread + esp_random() % (2 * spread + 1);
+}
+
 bool InkBridge::isRegistered()
 {
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
     return (_apiKey.length() > 0 && _deviceId.length() > 0 && _uid.length() > 0);
 }
 
@@ -111,657 +340,3306 @@ void InkBridge::setApiKey(String key)
 {
     if (key != "")
     {
+        InkLock lock(_locks[INK_SOURCE_CONFIG]);
         _apiKey = key;
-        NVSManager::saveApi(_apiKey);
+        NVSManager::saveApi(_apiKey, storage());
         Serial.println("[Ink] API Key Set Manually");
     }
 }
 
 String InkBridge::getApiKey()
 {
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
     return _apiKey;
 }
 
 String InkBridge::getDeviceId()
 {
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
     return _deviceId;
 }
 
 String InkBridge::getFriendlyId()
 {
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
     return _friendlyName;
 }
 
 String InkBridge::getApiUrl()
 {
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
     return _apiUrl;
 }
 
+bool InkBridge::addApiHost(String url)
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    if (url.length() == 0 || url.length() >= sizeof(InkHostPool::Host::url) || _hosts.add(url.c_str()) < 0)
+        return false;
+    if (NVSManager::isInit())
+        NVSManager::saveApiHosts(_hosts.extras(), storage());
+    return true;
+}
+
+void InkBridge::clearApiHosts()
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _hosts.reset(_apiUrl.c_str());
+    if (NVSManager::isInit())
+        NVSManager::saveApiHosts("", storage());
+}
+
+Response InkBridge::getApiHosts()
+{
+    Response r;
+    r.status = "OK";
+    JsonArray out = r.data.to<JsonArray>();
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    uint32_t now = millis();
+    int current = _hosts.pick(now);
+    for (int i = 0; i < _hosts.size(); i++)
+    {
+        const InkHostPool::Host &host = _hosts.at(i);
+        JsonObject item = out.add<JsonObject>();
+        item["url"] = host.url;
+        item["latency_ms"] = host.latencyMs;
+        item["error_rate"] = host.errorRate;
+        item["state"] = _hosts.isOpen(i, now) ? "open" : host.openUntil != 0 ? "half-open" : "closed";
+        item["selected"] = i == current;
+    }
+    return r;
+}
+
 String InkBridge::getUID()
 {
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
     return _uid;
 }
 
-Response InkBridge::sendRequest(String endpoint, String method, String payload)
+void InkBridge::setDecodeOnce(bool enabled)
 {
-    Response response;
-    if (WiFi.status() != WL_CONNECTED)
+    _decodeOnce = enabled;
+}
+
+#if INK_ENABLE_NEWS || INK_ENABLE_CALENDAR
+void InkBridge::setDeltaSync(bool enabled)
+{
+    _deltaSync = enabled;
+}
+
+static void idText(char *dst, size_t size, JsonVariantConst id)
+{
+    if (id.is<const char *>())
+        strlcpy(dst, id.as<const char *>(), size);
+    else if (id.is<long long>())
+        snprintf(dst, size, "%lld", id.as<long long>());
+    else
+        dst[0] = '\0';
+}
+
+static int findById(JsonArray arr, const char *idKey, JsonVariantConst id)
+{
+    int i = 0;
+    for (JsonVariant v : arr)
     {
-        if (WiFi.localIP() == INADDR_NONE && WiFi.localIP()[0] == 0)
-        {
-            Serial.println("[Error] WiFi not connected");
-            response.status = "WIFI_DISCONNECTED";
-            return response;
-        }
+        if (v[idKey] == id)
+            return i;
+        i++;
     }
+    return -1;
+}
 
-    WiFiClientSecure *client = new WiFiClientSecure();
-    if (!client)
+static int recordChange(ChangeSet &changes, JsonVariantConst id, ChangeKind kind)
+{
+    if (changes.count >= INK_MAX_CHANGES)
     {
-        response.status = "ALLOCATION_ERROR";
-        return response;
+        changes.full = true;
+        return -1;
     }
-    client->setInsecure(); // Skip cert validation
-    client->setHandshakeTimeout(10);
+    ChangedItem &item = changes.items[changes.count];
+    idText(item.id, sizeof(item.id), id);
+    item.kind = kind;
+    item.index = -1;
+    return changes.count++;
+}
 
-    HTTPClient *http = new HTTPClient();
-    if (!http)
+// Sync replies carry "sync_token" plus either the complete list under listKey
+// (first sync or token expired) or "added", "updated" and "deleted" (ids).
+void InkBridge::applySync(Response &local, Response &fresh, const char *listKey, const char *idKey, String &token, ChangeSet &changes)
+{
+    changes.full = false;
+    changes.count = 0;
+    changes.shiftedFrom = -1;
+    if (fresh.status != "OK")
     {
-        delete client;
-        response.status = "ALLOCATION_ERROR";
-        return response;
+        local.status = fresh.status; // keep the local set
+        return;
     }
-    http->setReuse(false);
-    http->setTimeout(15000);
+    token = fresh.data["sync_token"] | "";
 
-    String url = _apiUrl + endpoint;
+    if (!fresh.data[listKey].isNull() || local.data.isNull())
+    {
+        local = std::move(fresh);
+        changes.full = true;
+        return;
+    }
 
-    // For GET requests, we append query params manually.
-    // For POST, we rely on the JSON body.
-    if (method == "GET")
+    // Full ids of the recorded items; ChangedItem::id is only a display copy
+    JsonVariantConst ids[INK_MAX_CHANGES];
+    JsonArray arr = local.data[listKey];
+    for (JsonVariant id : fresh.data["deleted"].as<JsonArray>())
     {
-        url += (url.indexOf("?") == -1 ? "?" : "&");
-        url += "device_id=" + _deviceId;
-        if (_apiKey.length() > 0)
+        int i = findById(arr, idKey, id);
+        if (i < 0)
+            continue;
+        arr.remove(i);
+        if (changes.shiftedFrom < 0 || i < changes.shiftedFrom)
+            changes.shiftedFrom = i;
+        recordChange(changes, id, CHANGE_REMOVED);
+    }
+    for (JsonVariant item : fresh.data["updated"].as<JsonArray>())
+    {
+        int i = findById(arr, idKey, item[idKey]);
+        if (i < 0)
+            arr.add(item);
+        else
+            arr[i] = item;
+        int c = recordChange(changes, item[idKey], i < 0 ? CHANGE_ADDED : CHANGE_UPDATED);
+        if (c >= 0)
+            ids[c] = item[idKey];
+    }
+    for (JsonVariant item : fresh.data["added"].as<JsonArray>())
+    {
+        if (findById(arr, idKey, item[idKey]) >= 0)
+            continue;
+        arr.add(item);
+        int c = recordChange(changes, item[idKey], CHANGE_ADDED);
+        if (c >= 0)
+            ids[c] = item[idKey];
+    }
+
+    if (changes.count > 0)
+    {
+        // Removed and replaced values stay in the document pool; copy to compact it
+        local.data = JsonDocument(local.data);
+        arr = local.data[listKey];
+        for (int c = 0; c < changes.count; c++)
         {
-            url += "&api_key=" + _apiKey;
+            if (changes.items[c].kind != CHANGE_REMOVED)
+                changes.items[c].index = findById(arr, idKey, ids[c]);
         }
     }
+    local.status = "OK";
+}
+#endif
+
+bool InkBridge::wifiReady()
+{
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        if (WiFi.localIP() == INADDR_NONE && WiFi.localIP()[0] == 0)
+        {
+            Serial.println("[Error] WiFi not connected");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Connects http to endpoint and adds the identity headers. GET requests carry
+// the identity as query parameters, POST requests in the JSON body. A non-zero
+// rangeFrom asks for the body from that byte on. The connect, handshake and
+// read timeouts are cut to what is left of the deadline. A failed connect is
+// tried up to three times like performRequest: on another healthy host right
+// away (host is updated), otherwise on the same host after a short wait.
+bool InkBridge::openRequest(HTTPClient &http, WiFiClientSecure &client, const String &endpoint, const String &method, int &host,
+                            uint32_t &failed, uint32_t rangeFrom, uint32_t deadline)
+{
+    char url[INK_URL_BYTES];
+    bool plain = false;
+    for (int i = 0;; i++)
+    {
+        int32_t left = remainingMs(deadline);
+        if (left <= 0)
+            return false;
+        client.setInsecure(); // Skip cert validation
+        client.setHandshakeTimeout(left >= 10000 ? 10 : (left + 999) / 1000); // seconds
+        http.setReuse(false);
+        http.setConnectTimeout(min<int32_t>(5000, left)); // 5000 is HTTPClient's default
+        http.setTimeout(min<int32_t>(15000, left));
+
+        // The URL is built on the stack; identity and host are read under the config lock
+        char base[sizeof(InkHostPool::Host::url)];
+        {
+            InkLock lock(_locks[INK_SOURCE_CONFIG]);
+            strlcpy(base, host >= 0 && host < _hosts.size() ? _hosts.at(host).url : _apiUrl.c_str(), sizeof(base));
+            int n = snprintf(url, sizeof(url), "%s%s", base, endpoint.c_str());
+            if (method == "GET" && n > 0 && n < (int)sizeof(url))
+            {
+                snprintf(url + n, sizeof(url) - n, "%sdevice_id=%s%s%s", strchr(url, '?') ? "&" : "?", _deviceId.c_str(),
+                         _apiKey.length() > 0 ? "&api_key=" : "", _apiKey.c_str());
+            }
+        }
 
-    Serial.print("[HTTP] " + method + ": " + url);
+        Serial.printf("[HTTP] %s: %s", method.c_str(), url);
+
+        // HTTPClient reuses an already connected client, so a pre-warmed socket or a
+        // connect by the cached address skips the DNS lookup. HTTPClient is not left
+        // to connect on its own after a failure: it would only try the same host.
+        plain = strncmp(url, "http://", 7) == 0;
+        if (plain || client.connected())
+            break;
+        uint32_t start = millis();
+        if (connectCached(client, base))
+            break;
+        Serial.println(" [Error] Connect Failed");
+        if (!expired(deadline)) // a connect cut short by the deadline says nothing about the host
+            reportHost(host, -1, millis() - start, failed);
+        client.stop();
+
+        int next = i < 2 ? pickHost() : -1;
+        if (next < 0)
+            return false; // out of attempts, or every breaker is open
+        if (next != host)
+        {
+            Serial.print("[Failover] ");
+            host = next;
+            continue;
+        }
+        delay(min<int32_t>(1000, max<int32_t>(remainingMs(deadline), 0)));
+    }
 
-    if (!http->begin(*client, url))
+    // Plain http (e.g. a local test server) uses HTTPClient's own TCP client
+    bool opened = plain ? http.begin(url) : http.begin(client, url);
+    if (!opened)
     {
         Serial.println(" [Error] Connect Failed");
-        delete http;
-        delete client;
-        response.status = "CONNECT_FAILED";
-        return response;
+        return false;
     }
 
+    static const char *collect[] = {"Retry-After", "Content-Range", "X-Image-Width", "X-Image-Height", "X-Image-Depth"};
+    http.collectHeaders(collect, 5);
+
     // Standard Headers
-    http->addHeader("x-device-id", _deviceId);
-    if (_apiKey.length() > 0)
-        http->addHeader("x-api-key", _apiKey);
+    {
+        InkLock lock(_locks[INK_SOURCE_CONFIG]);
+        http.addHeader("x-device-id", _deviceId);
+        if (_apiKey.length() > 0)
+            http.addHeader("x-api-key", _apiKey);
+    }
 
     // JSON Header for POST requests
     if (method == "POST")
     {
-        http->addHeader("Content-Type", "application/json");
+        http.addHeader("Content-Type", "application/json");
     }
+    if (rangeFrom > 0)
+        http.addHeader("Range", "bytes=" + String((unsigned long)rangeFrom) + "-");
+    return true;
+}
 
+// Sends the request with up to three attempts; returns once the headers are in.
+// A failed attempt moves to another healthy host right away (host is updated)
+// and only waits before retrying when no other host is available.
+int InkBridge::performRequest(HTTPClient &http, WiFiClientSecure &client, const String &endpoint, const String &method,
+                              const InkPayload &payload, int &host, uint32_t &failed, uint32_t rangeFrom, uint32_t deadline)
+{
     int httpCode = -1;
     for (int i = 0; i < 3; i++)
     {
+        int32_t left = remainingMs(deadline);
+        if (left <= 0)
+            break; // the caller reports DEADLINE_EXCEEDED
+        if (i > 0)
+            http.setTimeout(min<int32_t>(15000, left));
+        uint32_t start = millis();
         if (method == "POST")
         {
-            httpCode = http->POST(payload);
+            httpCode = http.POST((uint8_t *)payload.data(), payload.length());
         }
         else
         {
-            httpCode = http->GET();
+            httpCode = http.GET();
         }
+        if (httpCode > 0 || !expired(deadline)) // a timeout cut short by the deadline is not the host's fault
+            reportHost(host, httpCode, millis() - start, failed);
 
         if (httpCode > 0)
             break;
-        Serial.print("."); // Retry indicator
-        delay(1000);
-    }
 
-    if (httpCode > 0)
-    {
-        String payload = http->getString();
-        DeserializationError error = deserializeJson(response.data, payload);
-
-        if (httpCode >= 400)
+        int next = pickHost();
+        if (next < 0)
+            break; // every breaker is open, fail fast
+        if (next != host)
         {
-            Serial.printf(" [Error %d] %s\n", httpCode, payload.c_str());
-            response.status = "HTTP_ERROR_" + String(httpCode);
-        }
-        else
-        {
-            Serial.println(" [Success]");
-            if (error)
-            {
-                response.status = "JSON_PARSE_ERROR";
-            }
-            else
-            {
-                response.status = "OK";
-            }
+            Serial.print(" [Failover]");
+            http.end();
+            client.stop();
+            host = next;
+            if (!openRequest(http, client, endpoint, method, host, failed, rangeFrom, deadline))
+                break;
+            continue;
         }
+        Serial.print("."); // Retry indicator
+        delay(min<int32_t>(1000, max<int32_t>(remainingMs(deadline), 0)));
     }
-    else
+    return httpCode;
+}
+
+int InkBridge::pickHost()
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    return _hosts.pick(millis());
+}
+
+// 5xx replies and transport errors count against the host; 4xx are the request's fault.
+// Retries within one call count a failure against each host only once.
+void InkBridge::reportHost(int host, int httpCode, uint32_t elapsedMs, uint32_t &failed)
+{
+    static_assert(INK_MAX_HOSTS <= 32, "failed holds one bit per host");
+    bool ok = httpCode > 0 && httpCode < 500;
+    if (!ok && host >= 0)
     {
-        Serial.printf(" [Fatal] %s\n", http->errorToString(httpCode).c_str());
-        response.status = "HTTP_ERROR_" + String(httpCode);
+        if (failed & (1UL << host))
+            return;
+        failed |= 1UL << host;
     }
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _hosts.report(host, ok, elapsedMs, millis());
+}
 
-    http->end();
-    delete http;
-    delete client;
-    return response;
+String InkBridge::requestStatus(int httpCode, DeserializationError error)
+{
+    if (httpCode == 429)
+        return "RATE_LIMITED";
+    if (httpCode <= 0 || httpCode >= 400)
+        return "HTTP_ERROR_" + String(httpCode);
+    return error ? "JSON_PARSE_ERROR" : "OK";
 }
 
-Response InkBridge::getRequest(String endpoint, bool includeApiKey)
+void InkBridge::setFixtureHook(FixtureHook hook)
 {
-    return sendRequest(endpoint, "GET", "");
+    _fixtureHook = hook;
 }
 
-bool InkBridge::registerDevice()
+void InkBridge::setRateLimit(String endpoint, float perMinute, uint8_t burst)
 {
-    Response response = sendRequest("/setup", "GET", "");
-    if (response.status != "OK")
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    if (burst == 0)
+        burst = 1;
+    if (endpoint.length() == 0)
     {
-        Serial.println("[Ink] Payload empty check API connection");
-        return false;
+        _defaultPerMinute = perMinute;
+        _defaultBurst = burst;
+        return;
     }
-    JsonDocument &doc = response.data;
+    RateBucket *bucket = bucketFor(endpoint, true);
+    if (!bucket)
+        return;
+    bucket->perMinute = perMinute;
+    bucket->burst = burst;
+    if (bucket->tokens > burst)
+        bucket->tokens = burst;
+}
 
-    if (doc["status"] != "success")
+// Caller holds the config lock. Returns nullptr (unlimited) once the table is full.
+InkBridge::RateBucket *InkBridge::bucketFor(const String &endpoint, bool create)
+{
+    for (int i = 0; i < _bucketCount; i++)
     {
-        Serial.println("[Ink] Registration Failed: " + doc["message"].as<String>());
-        return false;
+        if (endpoint == _buckets[i].endpoint)
+            return &_buckets[i];
     }
+    if (!create || _bucketCount >= INK_MAX_RATE_LIMITS)
+        return nullptr;
 
-    _apiKey = doc["api_key"].as<String>();
-    _friendlyName = doc["friendly_user_id"].as<String>();
-    _uid = doc["uid"].as<String>();
+    RateBucket *bucket = &_buckets[_bucketCount++];
+    strlcpy(bucket->endpoint, endpoint.c_str(), sizeof(bucket->endpoint));
+    bucket->perMinute = _defaultPerMinute;
+    bucket->burst = _defaultBurst;
+    bucket->tokens = _defaultBurst;
+    bucket->refilledAt = millis();
+    bucket->blockedUntil = 0;
+    return bucket;
+}
 
-    NVSManager::saveApi(_apiKey);
-    NVSManager::saveFriendlyUser(_friendlyName);
-    NVSManager::saveUID(_uid);
+bool InkBridge::allowRequest(const String &endpoint)
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    RateBucket *bucket = bucketFor(endpoint, true);
+    if (!bucket)
+        return true;
 
-    Serial.println("[Ink] Registration Successful! Linked to: " + _friendlyName);
+    uint32_t now = millis();
+    if (bucket->blockedUntil != 0)
+    {
+        if ((int32_t)(bucket->blockedUntil - now) > 0)
+        {
+            Serial.println("[Ink] " + endpoint + " backing off (Retry-After)");
+            return false;
+        }
+        bucket->blockedUntil = 0;
+    }
+
+    bucket->tokens += (now - bucket->refilledAt) * bucket->perMinute / 60000.0f;
+    if (bucket->tokens > bucket->burst)
+        bucket->tokens = bucket->burst;
+    bucket->refilledAt = now;
+    if (bucket->tokens < 1.0f)
+    {
+        Serial.println("[Ink] " + endpoint + " over its request budget");
+        return false;
+    }
+    bucket->tokens -= 1.0f;
     return true;
 }
 
-#if INK_ENABLE_WEATHER
-Response InkBridge::getWeather(String location)
+// Honours Retry-After on 429 and 503 replies. Only the delay-seconds form is
+// parsed; an HTTP date falls back to INK_RETRY_AFTER_DEFAULT_S.
+void InkBridge::backOff(const String &endpoint, int httpCode, const String &retryAfter)
 {
-    JsonDocument doc;
-    Serial.println("UID: " + _uid);
-    doc["uid"] = _uid; // Pass MAC address as UID
-    doc["device_id"] = _deviceId;
-    if (location != "")
-        doc["location"] = location;
+    if (httpCode != 429 && !(httpCode == 503 && retryAfter.length() > 0))
+        return;
+    long seconds = retryAfter.length() > 0 && isDigit(retryAfter[0]) ? retryAfter.toInt() : INK_RETRY_AFTER_DEFAULT_S;
+    Serial.printf("[Ink] %s throttled by server, retrying after %ld s\n", endpoint.c_str(), seconds);
 
-    String json;
-    serializeJson(doc, json);
-    weather = sendRequest("/weather", "POST", json);
-    return weather;
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    RateBucket *bucket = bucketFor(endpoint, true);
+    if (bucket)
+        bucket->blockedUntil = (millis() + seconds * 1000) | 1; // 0 means not blocked
 }
 
-double InkBridge::getWeatherTemperature(String location) {
-    if (weather.data.isNull()) getWeather(location);
-    return weather.data["temperature"].as<double>();
+// Admits gated requests one class at a time: a request waits while all slots
+// are busy or a higher class is waiting. Interactive requests are not gated.
+bool InkBridge::acquireSlot(InkPriority priority, uint32_t deadline)
+{
+    if (priority == INK_PRIORITY_INTERACTIVE)
+        return true;
+    bool queued = false;
+    for (;;)
+    {
+        {
+            InkLock lock(_locks[INK_SOURCE_CONFIG]);
+            bool yield = priority == INK_PRIORITY_BACKGROUND && _waitingRequests[INK_PRIORITY_NORMAL] > 0;
+            if (_activeRequests < INK_MAX_ACTIVE_REQUESTS && !yield)
+            {
+                if (queued)
+                    _waitingRequests[priority]--;
+                _activeRequests++;
+                return true;
+            }
+            if (expired(deadline))
+            {
+                if (queued)
+                    _waitingRequests[priority]--;
+                return false;
+            }
+            if (!queued)
+            {
+                _waitingRequests[priority]++;
+                queued = true;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
 }
 
-String InkBridge::getWeatherCondition(String location) {
-    if (weather.data.isNull()) getWeather(location);
-    return weather.data["condition"].as<String>();
+void InkBridge::releaseSlot(InkPriority priority)
+{
+    if (priority == INK_PRIORITY_INTERACTIVE)
+        return;
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _activeRequests--;
+}
+
+// Serializes a request body in one allocation instead of growing the String
+InkPayload::InkPayload(const char *text)
+{
+    assign(text, strlen(text));
+}
+
+InkPayload::InkPayload(const String &text)
+{
+    assign(text.c_str(), text.length());
+}
+
+InkPayload::InkPayload(const JsonDocument &doc)
+{
+    _length = measureJson(doc);
+    _inlined = _length < sizeof(_inline);
+    if (_inlined)
+    {
+        serializeJson(doc, _inline, sizeof(_inline));
+        return;
+    }
+    _text.reserve(_length);
+    serializeJson(doc, _text);
+}
+
+void InkPayload::assign(const char *text, size_t length)
+{
+    _length = length;
+    _inlined = length < sizeof(_inline);
+    if (_inlined)
+    {
+        memcpy(_inline, text, length);
+        _inline[length] = '\0';
+    }
+    else
+    {
+        _text = text;
+    }
+}
+
+const uint8_t *InkPayload::data() const
+{
+    return (const uint8_t *)(_inlined ? _inline : _text.c_str());
+}
+
+size_t InkPayload::length() const
+{
+    return _inlined ? _length : _text.length();
+}
+
+String InkPayload::str() const
+{
+    return _inlined ? String(_inline) : _text;
+}
+
+// Bounds the reads from a reply by the call's deadline: every read waits at most
+// what is left of it, and nothing is read once it has passed. A body that
+// trickles in therefore cannot outlast the budget.
+class InkDeadlineStream : public Stream
+{
+public:
+    InkDeadlineStream(Stream &stream, uint32_t deadline)
+        : _stream(stream), _deadline(deadline), _limit(stream.getTimeout()), _waitStarts(true), _expired(false)
+    {
+    }
+    // True once the deadline has passed, whether a read noticed it or a wait ran out at it
+    bool expired() const { return _expired || (_deadline && (int32_t)(_deadline - millis()) <= 0); }
+
+    int available() override { return budget() ? _stream.available() : 0; }
+    int read() override { return taken(budget() ? _stream.read() : -1); }
+    int peek() override { return budget() ? _stream.peek() : -1; }
+    size_t write(uint8_t) override { return 0; }
+    void flush() override {}
+
+private:
+    // Stream::readBytes() polls read() until its timeout, counted from the
+    // start of the wait. The timeout is set as a wait starts (after a byte
+    // arrived), so the wait ends no later than the deadline.
+    bool budget()
+    {
+        if (_expired)
+            return false;
+        if (!_deadline)
+            return true;
+        int32_t left = (int32_t)(_deadline - millis());
+        if (left <= 0)
+        {
+            _expired = true;
+            return false;
+        }
+        if (_waitStarts)
+            setTimeout(min<unsigned long>(_limit, left));
+        _waitStarts = false;
+        return true;
+    }
+    int taken(int c)
+    {
+        if (c >= 0)
+            _waitStarts = true;
+        return c;
+    }
+
+    Stream &_stream;
+    uint32_t _deadline;
+    unsigned long _limit;
+    bool _waitStarts;
+    bool _expired;
+};
+
+// Collects a reply body through HTTPClient::writeToStream(), which also undoes
+// chunked encoding. Each chunk cuts HTTPClient's read timeout to what is left
+// of the deadline; once it has passed the sink refuses data and the read ends.
+class InkBodySink : public Stream
+{
+public:
+    InkBodySink(String &body, HTTPClient &http, uint32_t deadline) : _body(body), _http(http), _deadline(deadline), _expired(false)
+    {
+        budget();
+    }
+    bool expired() const { return _expired || (_deadline && (int32_t)(_deadline - millis()) <= 0); }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t len) override
+    {
+        if (!budget())
+            return 0;
+        _body.concat((const char *)data, len);
+        return len;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+
+private:
+    bool budget()
+    {
+        if (_expired)
+            return false;
+        if (!_deadline)
+            return true;
+        int32_t left = (int32_t)(_deadline - millis());
+        if (left <= 0)
+        {
+            _expired = true;
+            return false;
+        }
+        _http.setTimeout(min<int32_t>(15000, left));
+        return true;
+    }
+
+    String &_body;
+    HTTPClient &_http;
+    uint32_t _deadline;
+    bool _expired;
+};
+
+// Passes a stream to ArduinoJson and counts the bytes it took.
+class InkCountingReader
+{
+public:
+    explicit InkCountingReader(Stream &stream) : _stream(stream), _count(0) {}
+
+    int read()
+    {
+        uint8_t c;
+        if (_stream.readBytes(&c, 1) != 1)
+            return -1;
+        _count++;
+        return c;
+    }
+    size_t readBytes(char *buffer, size_t length)
+    {
+        size_t done = _stream.readBytes(buffer, length);
+        _count += done;
+        return done;
+    }
+    size_t count() const { return _count; }
+
+private:
+    Stream &_stream;
+    size_t _count;
+};
+
+Response InkBridge::sendRequest(String endpoint, String method, const InkPayload &payload, InkPriority priority)
+{
+    Response response;
+    if (_fixtureHook && _fixtureHook(endpoint, payload.str(), response))
+    {
+        if (response.status.length() == 0)
+            response.status = "OK";
+        return response;
+    }
+
+    InkTiming timing = {};
+    timing.queuedUs = micros();
+    uint32_t deadline = deadlineFor();
+    if (!wifiReady())
+    {
+        response.status = "WIFI_DISCONNECTED";
+        return response;
+    }
+    if (!allowRequest(endpoint))
+    {
+        response.status = "RATE_LIMITED";
+        return response;
+    }
+    int host = pickHost();
+    if (host < 0)
+    {
+        response.status = "HOST_UNAVAILABLE";
+        return response;
+    }
+
+    if (!acquireSlot(priority, deadline))
+    {
+        response.status = "DEADLINE_EXCEEDED";
+        return response;
+    }
+    WiFiClientSecure *client = takeWarmClient(host, deadline);
+    if (!client)
+        client = newClient();
+    if (!client)
+    {
+        releaseSlot(priority);
+        response.status = "ALLOCATION_ERROR";
+        return response;
+    }
+
+    HTTPClient *http = newHttp();
+    if (!http)
+    {
+        dropClient(client);
+        releaseSlot(priority);
+        response.status = "ALLOCATION_ERROR";
+        return response;
+    }
+
+    uint32_t failed = 0;
+    if (!openRequest(*http, *client, endpoint, method, host, failed, 0, deadline))
+    {
+        dropHttp(http);
+        dropClient(client);
+        releaseSlot(priority);
+        response.status = expired(deadline) ? "DEADLINE_EXCEEDED" : "CONNECT_FAILED";
+        return response;
+    }
+
+    if (_steadyState)
+        http->useHTTP10(true); // no chunked encoding, so the body can be parsed off the socket
+
+    timing.sentUs = micros();
+    int httpCode = performRequest(*http, *client, endpoint, method, payload, host, failed, 0, deadline);
+    timing.firstByteUs = micros();
+    backOff(endpoint, httpCode, http->header("Retry-After"));
+
+    if (httpCode > 0 && _steadyState)
+    {
+        // No body String: the reply goes straight into the pooled document
+        InkDeadlineStream stream(http->getStream(), deadline);
+        InkCountingReader body(stream);
+        DeserializationError error = deserializeJson(response.data, body);
+        timing.receivedUs = timing.parsedUs = micros();
+        recordTraffic(payload.length(), body.count());
+        recordTiming(false, priority, timing);
+
+        response.status = error && stream.expired() ? "DEADLINE_EXCEEDED" : requestStatus(httpCode, error);
+        if (httpCode >= 400)
+            Serial.printf(" [Error %d]\n", httpCode);
+        else
+            Serial.println(" [Success]");
+    }
+    else if (httpCode > 0)
+    {
+        String body;
+        if (http->getSize() > 0)
+            body.reserve(http->getSize());
+        InkBodySink sink(body, *http, deadline);
+        http->writeToStream(&sink);
+        timing.receivedUs = micros();
+        recordTraffic(payload.length(), body.length());
+        DeserializationError error = deserializeJson(response.data, body);
+        timing.parsedUs = micros();
+        recordTiming(false, priority, timing);
+
+        response.status = error && sink.expired() ? "DEADLINE_EXCEEDED" : requestStatus(httpCode, error);
+        if (httpCode >= 400)
+        {
+            Serial.printf(" [Error %d] %s\n", httpCode, body.c_str());
+        }
+        else
+        {
+            Serial.println(" [Success]");
+        }
+    }
+    else
+    {
+        Serial.printf(" [Fatal] %s\n", http->errorToString(httpCode).c_str());
+        response.status = expired(deadline) ? "DEADLINE_EXCEEDED" : requestStatus(httpCode, DeserializationError::Ok);
+    }
+
+    http->end();
+    dropHttp(http);
+    dropClient(client);
+    releaseSlot(priority);
+    watchHeap();
+    return response;
+}
+
+Response InkBridge::getRequest(String endpoint, bool includeApiKey)
+{
+    return sendRequest(endpoint, "GET", "");
+}
+
+// ---------------------------------------------------------------------------
+// Deadline budgets
+// ---------------------------------------------------------------------------
+
+void InkBridge::setDeadline(uint32_t ms)
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _deadlineMs = ms;
+}
+
+// Opens or narrows this task's scope; returns the deadline to restore
+uint32_t InkBridge::beginDeadline(uint32_t ms)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    uint32_t until = (millis() + ms) | 1; // 0 means none
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    int free = -1;
+    for (int i = 0; i < INK_MAX_DEADLINES; i++)
+    {
+        if (_deadlines[i].task == task)
+        {
+            uint32_t previous = _deadlines[i].until;
+            if ((int32_t)(until - previous) < 0)
+                _deadlines[i].until = until;
+            return previous;
+        }
+        if (!_deadlines[i].task && free < 0)
+            free = i;
+    }
+    if (free < 0)
+    {
+        Serial.println("[Ink] Too many deadline scopes, raise INK_MAX_DEADLINES");
+        return 0;
+    }
+    _deadlines[free].task = task;
+    _deadlines[free].until = until;
+    return 0;
+}
+
+void InkBridge::endDeadline(uint32_t previous)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    for (int i = 0; i < INK_MAX_DEADLINES; i++)
+    {
+        if (_deadlines[i].task != task)
+            continue;
+        if (previous)
+            _deadlines[i].until = previous;
+        else
+            _deadlines[i].task = nullptr;
+        return;
+    }
+}
+
+// The earlier of the task's scope and the per-call budget
+uint32_t InkBridge::deadlineFor()
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    uint32_t now = millis();
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    uint32_t deadline = _deadlineMs > 0 ? (now + _deadlineMs) | 1 : 0;
+    for (int i = 0; i < INK_MAX_DEADLINES; i++)
+    {
+        if (_deadlines[i].task == task && (!deadline || (int32_t)(_deadlines[i].until - deadline) < 0))
+            deadline = _deadlines[i].until;
+    }
+    return deadline;
+}
+
+int32_t InkBridge::remainingMs(uint32_t deadline)
+{
+    return deadline ? (int32_t)(deadline - millis()) : INT32_MAX;
+}
+
+bool InkBridge::expired(uint32_t deadline)
+{
+    return remainingMs(deadline) <= 0;
+}
+
+// ---------------------------------------------------------------------------
+// Streaming list responses
+// ---------------------------------------------------------------------------
+
+// Hands ArduinoJson one character that was already read, then the stream.
+class InkPrefixedReader
+{
+public:
+    InkPrefixedReader(Stream &stream, int first) : _stream(stream), _pending(first) {}
+
+    int read()
+    {
+        if (_pending >= 0)
+        {
+            int c = _pending;
+            _pending = -1;
+            return c;
+        }
+        uint8_t c;
+        return _stream.readBytes(&c, 1) == 1 ? c : -1;
+    }
+    size_t readBytes(char *buffer, size_t length)
+    {
+        size_t done = 0;
+        if (length > 0 && _pending >= 0)
+        {
+            buffer[done++] = (char)_pending;
+            _pending = -1;
+        }
+        return done + _stream.readBytes(buffer + done, length - done);
+    }
+
+private:
+    Stream &_stream;
+    int _pending;
+};
+
+// Next character that is not whitespace or an element separator, -1 on timeout.
+static int nextListToken(Stream &stream)
+{
+    for (;;)
+    {
+        uint8_t c;
+        if (stream.readBytes(&c, 1) != 1)
+            return -1;
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t' && c != ',')
+            return c;
+    }
+}
+
+// Reads up to the '[' that opens the array at listKey in the top-level object,
+// or the top-level array itself when listKey is nullptr. Keys are matched only
+// at depth 1, so the same text in a string value or a nested object does not
+// count, and a body without the key fails at the object's closing brace rather
+// than after the read timeout.
+static bool findList(Stream &stream, const char *listKey)
+{
+    int c = nextListToken(stream);
+    if (!listKey)
+        return c == '[';
+    if (c != '{')
+        return false;
+
+    size_t keyLen = strlen(listKey);
+    int depth = 1;
+    bool atKey = true;
+    for (;;)
+    {
+        uint8_t b;
+        if (stream.readBytes(&b, 1) != 1)
+            return false;
+        if (b == '"')
+        {
+            bool key = depth == 1 && atKey;
+            bool match = key;
+            bool escaped = false;
+            size_t n = 0;
+            for (;;)
+            {
+                if (stream.readBytes(&b, 1) != 1)
+                    return false;
+                if (escaped)
+                    escaped = false;
+                else if (b == '\\')
+                    escaped = true;
+                else if (b == '"')
+                    break;
+                match = match && n < keyLen && listKey[n] == (char)b;
+                n++;
+            }
+            if (key)
+            {
+                atKey = false;
+                if (match && n == keyLen)
+                    return nextListToken(stream) == ':' && nextListToken(stream) == '[';
+            }
+        }
+        else if (b == '{' || b == '[')
+        {
+            depth++;
+        }
+        else if (b == '}' || b == ']')
+        {
+            if (--depth == 0)
+                return false;
+        }
+        else if (b == ',' && depth == 1)
+        {
+            atKey = true;
+        }
+    }
+}
+
+// Walks the array at listKey (or a top-level array when listKey is nullptr)
+// straight off the socket, one element per deserializeJson() call.
+Response InkBridge::streamList(const String &endpoint, const InkPayload &payload, const char *listKey, ItemCallback onItem, InkPriority priority)
+{
+    Response result;
+    int count = 0;
+
+    Response fixture;
+    if (_fixtureHook && _fixtureHook(endpoint, payload.str(), fixture))
+    {
+        JsonArrayConst arr = listKey ? fixture.data[listKey].as<JsonArrayConst>() : fixture.data.as<JsonArrayConst>();
+        for (JsonObjectConst item : arr)
+        {
+            if (!onItem(item, count++))
+                break;
+        }
+        result.status = fixture.status.length() > 0 ? fixture.status : "OK";
+        result.data["count"] = count;
+        return result;
+    }
+
+    uint32_t deadline = deadlineFor();
+    if (!wifiReady())
+    {
+        result.status = "WIFI_DISCONNECTED";
+        return result;
+    }
+    if (!allowRequest(endpoint))
+    {
+        result.status = "RATE_LIMITED";
+        return result;
+    }
+    int host = pickHost();
+    if (host < 0)
+    {
+        result.status = "HOST_UNAVAILABLE";
+        return result;
+    }
+
+    if (!acquireSlot(priority, deadline))
+    {
+        result.status = "DEADLINE_EXCEEDED";
+        return result;
+    }
+    WiFiClientSecure *client = takeWarmClient(host, deadline);
+    if (!client)
+        client = newClient();
+    HTTPClient *http = client ? newHttp() : nullptr;
+    if (!http)
+    {
+        dropClient(client);
+        releaseSlot(priority);
+        result.status = "ALLOCATION_ERROR";
+        return result;
+    }
+
+    uint32_t failed = 0;
+    if (!openRequest(*http, *client, endpoint, "POST", host, failed, 0, deadline))
+    {
+        result.status = expired(deadline) ? "DEADLINE_EXCEEDED" : "CONNECT_FAILED";
+    }
+    else
+    {
+        http->useHTTP10(true); // no chunked encoding, so the body can be read as it arrives
+        int httpCode = performRequest(*http, *client, endpoint, "POST", payload, host, failed, 0, deadline);
+        backOff(endpoint, httpCode, http->header("Retry-After"));
+        result.status = httpCode <= 0 && expired(deadline) ? "DEADLINE_EXCEEDED" : requestStatus(httpCode, DeserializationError::Ok);
+
+        if (httpCode > 0 && httpCode < 400)
+        {
+            Serial.println(" [Streaming]");
+            InkDeadlineStream body(http->getStream(), deadline);
+            bool found = findList(body, listKey);
+            if (!found)
+                result.status = "JSON_PARSE_ERROR";
+
+            JsonDocument item(&InkPool::shared()); // reused for every element
+            while (found)
+            {
+                int c = nextListToken(body);
+                if (c == ']')
+                    break;
+                if (c < 0)
+                {
+                    result.status = "JSON_PARSE_ERROR"; // connection dropped mid-list
+                    break;
+                }
+                InkPrefixedReader reader(body, c);
+                if (deserializeJson(item, reader))
+                {
+                    result.status = "JSON_PARSE_ERROR";
+                    break;
+                }
+                if (!onItem(item.as<JsonObjectConst>(), count++))
+                    break;
+            }
+            if (result.status == "JSON_PARSE_ERROR" && body.expired())
+                result.status = "DEADLINE_EXCEEDED"; // the items so far were delivered
+        }
+        else
+        {
+            Serial.printf(" [Error %d]\n", httpCode);
+        }
+    }
+
+    http->end();
+    dropHttp(http);
+    dropClient(client);
+    releaseSlot(priority);
+    watchHeap();
+    result.data["count"] = count;
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Binary images
+// ---------------------------------------------------------------------------
+
+// Total size from "bytes 100-999/1000", 0 when missing or "*"
+static uint32_t rangeTotal(const String &contentRange)
+{
+    int slash = contentRange.lastIndexOf('/');
+    return slash < 0 ? 0 : (uint32_t)contentRange.substring(slash + 1).toInt();
+}
+
+Response InkBridge::streamImage(String resource, uint16_t width, uint16_t height, uint8_t depth, ImageSink sink, uint32_t offset)
+{
+    static const char *ENDPOINT = "/image";
+    Response result;
+    InkImageInfo info = {width, height, depth, 0};
+
+    JsonDocument doc(&InkPool::shared());
+    identify(doc);
+    doc["resource"] = resource;
+    if (width > 0)
+        doc["width"] = width;
+    if (height > 0)
+        doc["height"] = height;
+    doc["depth"] = depth;
+    InkPayload payload(doc);
+
+    result.data["offset"] = offset;
+    if (!wifiReady())
+    {
+        result.status = "WIFI_DISCONNECTED";
+        return result;
+    }
+    if (!allowRequest(ENDPOINT))
+    {
+        result.status = "RATE_LIMITED";
+        return result;
+    }
+    int host = pickHost();
+    if (host < 0)
+    {
+        result.status = "HOST_UNAVAILABLE";
+        return result;
+    }
+
+    // The deadline bounds the setup: slot, connect and headers. The body is read to the end.
+    uint32_t deadline = deadlineFor();
+    if (!acquireSlot(INK_PRIORITY_NORMAL, deadline))
+    {
+        result.status = "DEADLINE_EXCEEDED";
+        return result;
+    }
+    WiFiClientSecure *client = takeWarmClient(host, deadline);
+    if (!client)
+        client = newClient();
+    HTTPClient *http = client ? newHttp() : nullptr;
+    if (!http)
+    {
+        dropClient(client);
+        releaseSlot(INK_PRIORITY_NORMAL);
+        result.status = "ALLOCATION_ERROR";
+        return result;
+    }
+
+    uint8_t chunk[INK_IMAGE_CHUNK];
+    bool stopped = false;
+    uint32_t failed = 0;
+    for (int attempt = 0; attempt <= INK_IMAGE_RESUMES && !stopped; attempt++)
+    {
+        if (attempt > 0)
+        {
+            Serial.printf("[Ink] Image broke off at %lu, resuming\n", (unsigned long)offset);
+            http->end();
+            client->stop();
+            if ((host = pickHost()) < 0)
+            {
+                result.status = "HOST_UNAVAILABLE";
+                break;
+            }
+        }
+        if (!openRequest(*http, *client, ENDPOINT, "POST", host, failed, offset, deadline))
+        {
+            result.status = expired(deadline) ? "DEADLINE_EXCEEDED" : "CONNECT_FAILED";
+            break;
+        }
+        http->useHTTP10(true); // raw body, no chunked encoding
+        int httpCode = performRequest(*http, *client, ENDPOINT, "POST", payload, host, failed, offset, deadline);
+        backOff(ENDPOINT, httpCode, http->header("Retry-After"));
+        if (httpCode != HTTP_CODE_OK && httpCode != HTTP_CODE_PARTIAL_CONTENT)
+        {
+            // performRequest already retried; only a body that breaks off is resumed
+            Serial.printf(" [Error %d]\n", httpCode);
+            if (httpCode <= 0 && expired(deadline))
+                result.status = "DEADLINE_EXCEEDED";
+            else
+                result.status = httpCode > 0 && httpCode < 400 ? "HTTP_ERROR_" + String(httpCode) : requestStatus(httpCode, DeserializationError::Ok);
+            break;
+        }
+        Serial.println(" [Streaming]");
+
+        if (http->hasHeader("X-Image-Width"))
+            info.width = http->header("X-Image-Width").toInt();
+        if (http->hasHeader("X-Image-Height"))
+            info.height = http->header("X-Image-Height").toInt();
+        if (http->hasHeader("X-Image-Depth"))
+            info.depth = http->header("X-Image-Depth").toInt();
+
+        // A server that ignores Range sends the whole image again; skip what the sink already has
+        uint32_t skip = 0;
+        int size = http->getSize();
+        if (httpCode == HTTP_CODE_PARTIAL_CONTENT)
+            info.total = rangeTotal(http->header("Content-Range"));
+        else
+        {
+            skip = offset;
+            if (size >= 0)
+                info.total = size;
+        }
+        uint32_t remaining = info.total == 0 ? UINT32_MAX : (offset < info.total ? info.total - offset : 0);
+
+        // Without a length the body ends when the server closes the connection
+        Stream &body = http->getStream();
+        bool ended = false;
+        while (skip > 0)
+        {
+            size_t got = body.readBytes(chunk, min<uint32_t>(skip, sizeof(chunk)));
+            if (got == 0)
+                break;
+            skip -= got;
+        }
+        while (skip == 0 && remaining > 0)
+        {
+            if (info.total == 0 && !body.available() && !http->connected())
+            {
+                ended = true;
+                break;
+            }
+            size_t got = body.readBytes(chunk, min<uint32_t>(remaining, sizeof(chunk)));
+            if (got == 0)
+                break; // connection dropped or stalled
+            recordTraffic(0, got);
+            if (!sink(chunk, got, offset, info))
+            {
+                stopped = true;
+                offset += got;
+                break;
+            }
+            offset += got;
+            remaining -= got;
+        }
+
+        bool complete = info.total > 0 ? offset >= info.total : ended;
+        if (complete || stopped)
+        {
+            result.status = "OK";
+            break;
+        }
+        result.status = "INCOMPLETE";
+    }
+
+    http->end();
+    dropHttp(http);
+    dropClient(client);
+    releaseSlot(INK_PRIORITY_NORMAL);
+    watchHeap();
+
+    result.data["offset"] = offset;
+    result.data["total"] = info.total;
+    result.data["width"] = info.width;
+    result.data["height"] = info.height;
+    result.data["depth"] = info.depth;
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Connection pre-warming
+// ---------------------------------------------------------------------------
+
+void InkBridge::setPrewarm(bool enabled)
+{
+    _prewarmEnabled = enabled;
+}
+
+// Splits an API base URL into host and port; only https URLs are pre-warmed.
+bool InkBridge::apiHost(const char *url, char *host, size_t size, uint16_t &port)
+{
+    if (strncmp(url, "https://", 8) != 0)
+        return false;
+    const char *start = url + 8;
+    size_t len = strcspn(start, "/");
+    const char *colon = (const char *)memchr(start, ':', len);
+    port = colon ? atoi(colon + 1) : 443;
+    if (colon)
+        len = colon - start;
+    if (len == 0 || len >= size)
+        return false;
+    memcpy(host, start, len);
+    host[len] = '\0';
+    return true;
+}
+
+// Cached lookup of the API host. The Arduino resolver does not report the
+// record's TTL, so entries live for INK_DNS_TTL_MS or until a connect fails.
+bool InkBridge::resolveApiHost(const char *host, IPAddress &ip)
+{
+    {
+        InkLock lock(_locks[INK_SOURCE_CONFIG]);
+        if (_dnsHost == host && _dnsAt != 0 && millis() - _dnsAt < INK_DNS_TTL_MS)
+        {
+            ip = _dnsAddress;
+            return true;
+        }
+    }
+
+    if (!WiFi.hostByName(host, ip))
+    {
+        Serial.printf("[Ink] DNS lookup failed for %s\n", host);
+        return false;
+    }
+
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _dnsHost = host;
+    _dnsAddress = ip;
+    _dnsAt = millis() | 1; // 0 marks an empty cache
+    return true;
+}
+
+void InkBridge::forgetApiHost()
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _dnsAt = 0;
+}
+
+// Connects client by the cached address, sending the host name for SNI, so
+// HTTPClient finds it already connected and skips its own lookup.
+bool InkBridge::connectCached(WiFiClientSecure &client, const char *base)
+{
+    char host[sizeof(InkHostPool::Host::url)];
+    uint16_t port;
+    IPAddress ip;
+    if (!apiHost(base, host, sizeof(host), port) || !resolveApiHost(host, ip))
+        return false;
+    if (!client.connect(ip, port, host, nullptr, nullptr, nullptr))
+    {
+        forgetApiHost();
+        return false;
+    }
+    return true;
+}
+
+void InkBridge::onConnected()
+{
+    if (_prewarmEnabled)
+        prewarm();
+#if INK_ENABLE_SPOTIFY
+    startReplay();
+#endif
+}
+
+// Starts a background lookup and TLS handshake with the API host. The next
+// request picks up the open connection instead of making its own.
+bool InkBridge::prewarm()
+{
+    if (WiFi.status() != WL_CONNECTED)
+        return false;
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    if (_prewarmTask)
+        return true;
+    if (xTaskCreatePinnedToCore(prewarmTask, "ink_warm", 6144, this, 1, &_prewarmTask, 0) != pdPASS)
+    {
+        _prewarmTask = nullptr;
+        Serial.println("[Ink] Pre-warm task creation failed");
+        return false;
+    }
+    return true;
+}
+
+void InkBridge::prewarmTask(void *arg)
+{
+    InkBridge *self = (InkBridge *)arg;
+    uint32_t start = millis();
+
+    String base;
+    {
+        InkLock lock(self->_locks[INK_SOURCE_CONFIG]);
+        int host = self->_hosts.pick(start);
+        if (host >= 0)
+            base = self->_hosts.at(host).url;
+    }
+
+    WiFiClientSecure *client = base.length() > 0 ? self->newClient() : nullptr;
+    if (client)
+    {
+        client->setInsecure(); // Skip cert validation
+        client->setHandshakeTimeout(10);
+        if (self->connectCached(*client, base.c_str()))
+        {
+            Serial.printf("[Ink] Connection pre-warmed in %lu ms\n", (unsigned long)(millis() - start));
+            InkLock lock(self->_locks[INK_SOURCE_CONFIG]);
+            self->dropClient(self->_warmClient);
+            self->_warmClient = client;
+            self->_warmBase = base;
+            self->_warmAt = millis();
+            client = nullptr;
+        }
+        else
+        {
+            Serial.println("[Ink] Pre-warm failed, requests will connect on demand");
+        }
+        self->dropClient(client);
+    }
+
+    {
+        InkLock lock(self->_locks[INK_SOURCE_CONFIG]);
+        self->_prewarmTask = nullptr;
+    }
+    vTaskDelete(nullptr);
+}
+
+// Hands out the pre-warmed connection once. A handshake still in progress is
+// waited for, since starting a second one would only take longer. A connection
+// to a different host than the request picked is dropped.
+WiFiClientSecure *InkBridge::takeWarmClient(int host, uint32_t deadline)
+{
+    for (;;)
+    {
+        {
+            InkLock lock(_locks[INK_SOURCE_CONFIG]);
+            if (!_prewarmTask)
+                break;
+        }
+        if (expired(deadline))
+            return nullptr; // the caller gives up; the handshake finishes for the next request
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    WiFiClientSecure *client = _warmClient;
+    _warmClient = nullptr;
+    if (client && (millis() - _warmAt > INK_PREWARM_IDLE_MS || !client->connected()))
+    {
+        dropClient(client); // the server has likely dropped an idle connection
+        client = nullptr;
+    }
+    if (client && host >= 0 && (host >= _hosts.size() || _warmBase != _hosts.at(host).url))
+    {
+        dropClient(client);
+        client = nullptr;
+    }
+    return client;
+}
+
+// ---------------------------------------------------------------------------
+// Steady-state memory
+// ---------------------------------------------------------------------------
+
+void InkBridge::setSteadyState(bool enabled)
+{
+    _steadyState = enabled;
+}
+
+// Client objects come from the pools, which hand out new ones until begin()
+// reserves them in steady-state mode.
+WiFiClientSecure *InkBridge::newClient()
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    return _clientPool.take();
+}
+
+void InkBridge::dropClient(WiFiClientSecure *client)
+{
+    if (!client)
+        return;
+    client->stop(); // a pooled client is not destroyed, so close it here
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _clientPool.give(client);
+}
+
+HTTPClient *InkBridge::newHttp()
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    return _httpPool.take();
+}
+
+void InkBridge::dropHttp(HTTPClient *http)
+{
+    if (!http)
+        return;
+    http->useHTTP10(false); // streamed requests switch it on
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _httpPool.give(http);
+}
+
+InkPoolStats InkBridge::getPoolStats()
+{
+    InkPoolStats stats = InkPool::shared().stats();
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    stats.connectionMisses = _clientPool.misses() + _httpPool.misses();
+    return stats;
+}
+
+void InkBridge::watchHeap()
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    uint32_t now = millis();
+    if (_heap.due(now))
+        _heap.record(InkHeapMonitor::read(now));
+}
+
+InkHeapSample InkBridge::sampleHeap()
+{
+    InkHeapSample sample = InkHeapMonitor::read(millis());
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _heap.record(sample);
+    return sample;
+}
+
+int InkBridge::getHeapHistory(InkHeapSample *out, int max, InkHeapSample *baseline, InkHeapSample *lowest)
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    int count = min(max, _heap.size());
+    int skip = _heap.size() - count; // the newest ones matter most
+    for (int i = 0; i < count; i++)
+        out[i] = _heap.at(skip + i);
+    if (baseline)
+        *baseline = _heap.baseline();
+    if (lowest)
+        *lowest = _heap.lowest();
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// Endpoint table
+// ---------------------------------------------------------------------------
+
+#if INK_ENABLE_WEATHER
+static const InkEndpoint EP_WEATHER = {"/weather", INK_PRIORITY_NORMAL, INK_SOURCE_WEATHER, &InkBridge::weather, 1, {{"location", INK_PARAM_OPTIONAL}}};
+static const InkEndpoint EP_FORECAST = {"/weather/forecast", INK_PRIORITY_NORMAL, INK_SOURCE_FORECAST, &InkBridge::weatherForecast, 2,
+                                        {{"location", INK_PARAM_OPTIONAL}, {"days", INK_PARAM_NUMBER}}};
+static const InkEndpoint EP_HISTORY = {"/weather/history", INK_PRIORITY_BACKGROUND, INK_SOURCE_HISTORY, &InkBridge::weatherHistory, 3,
+                                       {{"location", INK_PARAM_OPTIONAL}, {"date", INK_PARAM_OPTIONAL}, {"end_date", INK_PARAM_OPTIONAL}}};
+static const InkEndpoint EP_ASTRONOMY = {"/weather/astronomy", INK_PRIORITY_NORMAL, INK_SOURCE_ASTRONOMY, &InkBridge::astronomy, 1, {{"location", INK_PARAM_OPTIONAL}}};
+#endif
+#if INK_ENABLE_STOCKS
+static const InkEndpoint EP_STOCK = {"/stock", INK_PRIORITY_NORMAL, INK_SOURCE_STOCKS, &InkBridge::stocks, 1, {{"symbol", INK_PARAM_OPTIONAL}}};
+static const InkEndpoint EP_STOCK_ARRAY = {"/stock/array", INK_PRIORITY_BACKGROUND, INK_SOURCE_STOCKS, nullptr, 2,
+                                           {{"symbol", INK_PARAM_OPTIONAL}, {"days", INK_PARAM_NUMBER}}};
+#endif
+#if INK_ENABLE_CRYPTO
+static const InkEndpoint EP_CRYPTO = {"/crypto", INK_PRIORITY_NORMAL, INK_SOURCE_CRYPTO, &InkBridge::crypto, 1, {{"symbol", INK_PARAM_OPTIONAL}}};
+static const InkEndpoint EP_CRYPTO_ARRAY = {"/crypto/array", INK_PRIORITY_BACKGROUND, INK_SOURCE_CRYPTO, nullptr, 2,
+                                            {{"symbol", INK_PARAM_OPTIONAL}, {"days", INK_PARAM_NUMBER}}};
+#endif
+#if INK_ENABLE_TRAVEL
+static const InkEndpoint EP_TRAVEL = {"/travel", INK_PRIORITY_NORMAL, INK_SOURCE_TRAVEL, &InkBridge::travel, 3,
+                                      {{"origin", INK_PARAM_OPTIONAL}, {"destination", INK_PARAM_OPTIONAL}, {"mode", INK_PARAM_TEXT}}};
+#endif
+#if INK_ENABLE_SPOTIFY
+static const InkEndpoint EP_SPOTIFY_REQUEST = {"/spotify/request", INK_PRIORITY_INTERACTIVE, INK_SOURCE_SPOTIFY, nullptr, 3,
+                                               {{"endpoint", INK_PARAM_TEXT}, {"method", INK_PARAM_TEXT}, {"body", INK_PARAM_OPTIONAL}}};
+static const InkEndpoint EP_SPOTIFY_ALBUMS = {"/spotify/user_albums", INK_PRIORITY_NORMAL, INK_SOURCE_SPOTIFY, nullptr, 2,
+                                              {{"limit", INK_PARAM_NUMBER}, {"offset", INK_PARAM_NUMBER}}};
+static const InkEndpoint EP_SPOTIFY_PLAYLISTS = {"/spotify/user_playlists", INK_PRIORITY_NORMAL, INK_SOURCE_SPOTIFY, nullptr, 2,
+                                                 {{"limit", INK_PARAM_NUMBER}, {"offset", INK_PARAM_NUMBER}}};
+static const InkEndpoint EP_SPOTIFY_LIKED = {"/spotify/liked_songs", INK_PRIORITY_NORMAL, INK_SOURCE_SPOTIFY, nullptr, 2,
+                                             {{"limit", INK_PARAM_NUMBER}, {"offset", INK_PARAM_NUMBER}}};
+static const InkEndpoint EP_SPOTIFY_ARTISTS = {"/spotify/followed_artists", INK_PRIORITY_NORMAL, INK_SOURCE_SPOTIFY, nullptr, 2,
+                                               {{"limit", INK_PARAM_NUMBER}, {"after", INK_PARAM_OPTIONAL}}};
+static const InkEndpoint EP_SPOTIFY_DEVICES = {"/spotify/devices", INK_PRIORITY_INTERACTIVE, INK_SOURCE_SPOTIFY, nullptr, 0, {}};
+#endif
+#if INK_ENABLE_NEWS
+static Response fetchNews(InkBridge &ink, const InkValue *values) { return ink.getNews(*values[0].text); }
+static const InkEndpoint EP_NEWS = {"/news", INK_PRIORITY_BACKGROUND, INK_SOURCE_NEWS, &InkBridge::news, 1, {{"category", INK_PARAM_TEXT}}, fetchNews};
+#endif
+#if INK_ENABLE_CALENDAR
+static Response fetchCalendar(InkBridge &ink, const InkValue *values) { return ink.getCalendar(*values[0].text); }
+static const InkEndpoint EP_CALENDAR = {"/calendar", INK_PRIORITY_BACKGROUND, INK_SOURCE_CALENDAR, &InkBridge::calendar, 1, {{"range", INK_PARAM_TEXT}}, fetchCalendar};
+#endif
+#if INK_ENABLE_CANVAS
+static Response fetchCanvasTodos(InkBridge &ink, const InkValue *values) { return ink.getCanvas("todo", *values[0].text, *values[1].text); }
+static Response fetchCanvasGrades(InkBridge &ink, const InkValue *values) { return ink.getCanvas("grades", *values[0].text, *values[1].text); }
+static const InkEndpoint EP_CANVAS_TODOS = {"/canvas", INK_PRIORITY_BACKGROUND, INK_SOURCE_CANVAS, &InkBridge::canvasTodos, 2,
+                                            {{"domain", INK_PARAM_OPTIONAL}, {"canvas_key", INK_PARAM_OPTIONAL}}, fetchCanvasTodos};
+static const InkEndpoint EP_CANVAS_GRADES = {"/canvas", INK_PRIORITY_BACKGROUND, INK_SOURCE_CANVAS, &InkBridge::canvasGrades, 2,
+                                             {{"domain", INK_PARAM_OPTIONAL}, {"canvas_key", INK_PARAM_OPTIONAL}}, fetchCanvasGrades};
+#endif
+
+// ---------------------------------------------------------------------------
+// Pipelined mode
+// ---------------------------------------------------------------------------
+
+struct InkBridge::InkJob
+{
+    uint32_t tag;
+    InkPriority priority;
+    InkSource source;
+    String endpoint;
+    String payload;
+    String key; // news category or calendar range
+    int httpCode;
+    String status; // set when the transfer failed before any body arrived
+    InkTiming timing;
+};
+
+// Producer end of the ring as an Arduino Stream, so HTTPClient::writeToStream()
+// can feed it (and undo chunked transfer encoding on the way). Blocks while the
+// ring is full.
+class InkRingStream : public Stream
+{
+public:
+    InkRingStream(InkRingBuffer &ring, TaskHandle_t reader) : _ring(ring), _reader(reader), _written(0) {}
+    size_t written() const { return _written; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t len) override
+    {
+        size_t done = 0;
+        while (done < len)
+        {
+            size_t n = _ring.write(data + done, len - done);
+            done += n;
+            _written += n;
+            if (n > 0)
+                xTaskNotifyGive(_reader);
+            else
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+        }
+        return done;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+
+private:
+    InkRingBuffer &_ring;
+    TaskHandle_t _reader;
+    size_t _written;
+};
+
+// Consumer end of the ring in the shape ArduinoJson reads from. Blocks until
+// bytes arrive or the producer closes the ring; single-byte reads are served
+// from a small local buffer.
+class InkRingReader
+{
+public:
+    InkRingReader(InkRingBuffer &ring, TaskHandle_t writer) : _ring(ring), _writer(writer), _pos(0), _len(0) {}
+
+    int read()
+    {
+        if (_pos == _len)
+        {
+            _pos = 0;
+            _len = fill(_buffer, 1, sizeof(_buffer));
+            if (_len == 0)
+                return -1;
+        }
+        return _buffer[_pos++];
+    }
+    size_t readBytes(char *buffer, size_t length)
+    {
+        size_t done = 0;
+        while (done < length && _pos < _len)
+            buffer[done++] = _buffer[_pos++];
+        if (done < length)
+            done += fill((uint8_t *)buffer + done, length - done, length - done);
+        return done;
+    }
+    void drain() // discards trailing bytes so the producer never stalls
+    {
+        _pos = _len = 0;
+        while (fill(_buffer, sizeof(_buffer), sizeof(_buffer)) > 0)
+        {
+        }
+    }
+
+private:
+    // Copies at least min bytes (fewer only at end of stream), at most max
+    size_t fill(uint8_t *out, size_t min, size_t max)
+    {
+        size_t done = 0;
+        while (done < min)
+        {
+            size_t n = _ring.read(out + done, max - done);
+            done += n;
+            if (n > 0)
+                xTaskNotifyGive(_writer);
+            else if (_ring.finished())
+                break;
+            else
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+        }
+        return done;
+    }
+
+    InkRingBuffer &_ring;
+    TaskHandle_t _writer;
+    uint8_t _buffer[64];
+    size_t _pos;
+    size_t _len;
+};
+
+bool InkBridge::beginPipeline(size_t ringSize)
+{
+    if (_netTask)
+        return true;
+    if (!_ring.allocate(ringSize))
+    {
+        Serial.println("[Ink] Pipeline ring allocation failed");
+        return false;
+    }
+
+    bool queues = true;
+    for (int i = 0; i < INK_PRIORITY_COUNT; i++)
+        queues = (_jobQueue[i] = xQueueCreate(INK_PIPELINE_DEPTH, sizeof(InkJob *))) && queues;
+    _jobSignal = xSemaphoreCreateCounting(INK_PIPELINE_DEPTH * INK_PRIORITY_COUNT + 1, 0);
+    _parseQueue = xQueueCreate(1, sizeof(InkJob *));
+    _resultQueue = xQueueCreate(INK_PIPELINE_DEPTH, sizeof(InkResult *));
+    _parseDone = xSemaphoreCreateBinary();
+    _pipeStopped = xSemaphoreCreateCounting(2, 0);
+    if (!queues || !_jobSignal || !_parseQueue || !_resultQueue || !_parseDone || !_pipeStopped)
+    {
+        Serial.println("[Ink] Pipeline queue allocation failed");
+        endPipeline();
+        return false;
+    }
+
+    // Transport on core 0 next to the WiFi stack, parsing on core 1 next to loop()
+    if (xTaskCreatePinnedToCore(parserTask, "ink_parse", 8192, this, 1, &_parseTask, 1) != pdPASS ||
+        xTaskCreatePinnedToCore(networkTask, "ink_net", 8192, this, 1, &_netTask, 0) != pdPASS)
+    {
+        Serial.println("[Ink] Pipeline task creation failed");
+        endPipeline();
+        return false;
+    }
+    return true;
+}
+
+void InkBridge::endPipeline()
+{
+    if (_netTask)
+    {
+        // A null job stops the network task once its transfer is done, and it
+        // passes the job on to the parser. Both report on _pipeStopped, which
+        // unlike _parseDone is never taken by the network task.
+        InkJob *stop = nullptr;
+        xQueueSend(_jobQueue[INK_PRIORITY_INTERACTIVE], &stop, portMAX_DELAY);
+        xSemaphoreGive(_jobSignal);
+        xSemaphoreTake(_pipeStopped, portMAX_DELAY);
+        xSemaphoreTake(_pipeStopped, portMAX_DELAY);
+        vTaskDelay(1); // let both tasks finish deleting themselves
+    }
+    else if (_parseTask)
+    {
+        vTaskDelete(_parseTask);
+    }
+    _netTask = nullptr;
+    _parseTask = nullptr;
+
+    InkJob *job;
+    for (int i = 0; i < INK_PRIORITY_COUNT; i++)
+    {
+        while (_jobQueue[i] && xQueueReceive(_jobQueue[i], &job, 0) == pdTRUE)
+            delete job;
+        if (_jobQueue[i])
+            vQueueDelete(_jobQueue[i]);
+        _jobQueue[i] = nullptr;
+    }
+    InkResult *result;
+    while (_resultQueue && xQueueReceive(_resultQueue, &result, 0) == pdTRUE)
+        delete result;
+
+    if (_jobSignal)
+        vSemaphoreDelete(_jobSignal);
+    if (_parseQueue)
+        vQueueDelete(_parseQueue);
+    if (_resultQueue)
+        vQueueDelete(_resultQueue);
+    if (_parseDone)
+        vSemaphoreDelete(_parseDone);
+    if (_pipeStopped)
+        vSemaphoreDelete(_pipeStopped);
+    _parseQueue = _resultQueue = nullptr;
+    _parseDone = _jobSignal = _pipeStopped = nullptr;
+}
+
+bool InkBridge::submit(InkJob *job)
+{
+    if (!job)
+        return false;
+    if (!_netTask)
+    {
+        Serial.println("[Ink] Pipeline not started");
+        delete job;
+        return false;
+    }
+    job->httpCode = 0;
+    job->timing = {};
+    job->timing.queuedUs = micros();
+    if (xQueueSend(_jobQueue[job->priority], &job, 0) != pdTRUE)
+    {
+        Serial.println("[Ink] Pipeline busy, job dropped");
+        delete job;
+        return false;
+    }
+    xSemaphoreGive(_jobSignal);
+    return true;
+}
+
+bool InkBridge::submitRequest(String endpoint, String payload, uint32_t tag, InkPriority priority)
+{
+    InkJob *job = new InkJob();
+    if (job)
+    {
+        job->tag = tag;
+        job->priority = priority;
+        job->source = INK_SOURCE_COUNT;
+        job->endpoint = endpoint;
+        job->payload = payload;
+    }
+    return submit(job);
+}
+
+#if INK_ENABLE_NEWS
+bool InkBridge::submitNews(String category, uint32_t tag)
+{
+    InkJob *job = new InkJob();
+    if (job)
+    {
+        job->tag = tag;
+        job->priority = EP_NEWS.priority;
+        job->source = EP_NEWS.source;
+        job->endpoint = EP_NEWS.path;
+        job->payload = newsPayload(category).str();
+        job->key = category;
+    }
+    return submit(job);
+}
+#endif
+
+#if INK_ENABLE_CALENDAR
+bool InkBridge::submitCalendar(String range, uint32_t tag)
+{
+    InkJob *job = new InkJob();
+    if (job)
+    {
+        job->tag = tag;
+        job->priority = EP_CALENDAR.priority;
+        job->source = EP_CALENDAR.source;
+        job->endpoint = EP_CALENDAR.path;
+        job->payload = calendarPayload(range).str();
+        job->key = range;
+    }
+    return submit(job);
+}
+#endif
+
+bool InkBridge::nextResult(InkResult &result, uint32_t waitMs)
+{
+    InkResult *next;
+    if (!_resultQueue || xQueueReceive(_resultQueue, &next, pdMS_TO_TICKS(waitMs)) != pdTRUE)
+        return false;
+    result = std::move(*next);
+    delete next;
+    return true;
+}
+
+void InkBridge::networkTask(void *arg)
+{
+    InkBridge *self = (InkBridge *)arg;
+    for (;;)
+    {
+        if (xSemaphoreTake(self->_jobSignal, portMAX_DELAY) != pdTRUE)
+            continue;
+        // Highest class first
+        InkJob *job = nullptr;
+        int priority = 0;
+        while (priority < INK_PRIORITY_COUNT && xQueueReceive(self->_jobQueue[priority], &job, 0) != pdTRUE)
+            priority++;
+        if (priority == INK_PRIORITY_COUNT)
+            continue;
+        if (!job)
+        {
+            xQueueSend(self->_parseQueue, &job, portMAX_DELAY);
+            xSemaphoreGive(self->_pipeStopped);
+            vTaskDelete(nullptr);
+            return;
+        }
+        self->transfer(job);
+    }
+}
+
+void InkBridge::parserTask(void *arg)
+{
+    InkBridge *self = (InkBridge *)arg;
+    for (;;)
+    {
+        InkJob *job;
+        if (xQueueReceive(self->_parseQueue, &job, portMAX_DELAY) != pdTRUE)
+            continue;
+        if (!job)
+        {
+            xSemaphoreGive(self->_pipeStopped);
+            vTaskDelete(nullptr);
+            return;
+        }
+        self->parse(job);
+    }
+}
+
+// Network side: the job goes to the parser as soon as the headers are in, then
+// the body is streamed through the ring while the parser consumes it.
+void InkBridge::transfer(InkJob *job)
+{
+    _ring.reset();
+    WiFiClientSecure *client = nullptr;
+    HTTPClient *http = nullptr;
+    bool admitted = false;
+    int host = -1;
+    uint32_t failed = 0;
+    uint32_t deadline = deadlineFor(); // the setDeadline() budget; the network task opens no scopes
+
+    if (!wifiReady())
+    {
+        job->status = "WIFI_DISCONNECTED";
+    }
+    else if (!allowRequest(job->endpoint))
+    {
+        job->status = "RATE_LIMITED";
+    }
+    else if ((host = pickHost()) < 0)
+    {
+        job->status = "HOST_UNAVAILABLE";
+    }
+    else if (!(admitted = acquireSlot(job->priority, deadline)))
+    {
+        job->status = "DEADLINE_EXCEEDED";
+    }
+    else
+    {
+        client = takeWarmClient(host, deadline);
+        if (!client)
+            client = newClient();
+        if (!client || !(http = newHttp()))
+        {
+            job->status = "ALLOCATION_ERROR";
+        }
+        else if (!openRequest(*http, *client, job->endpoint, "POST", host, failed, 0, deadline))
+        {
+            job->status = expired(deadline) ? "DEADLINE_EXCEEDED" : "CONNECT_FAILED";
+        }
+        else
+        {
+            job->timing.sentUs = micros();
+            job->httpCode = performRequest(*http, *client, job->endpoint, "POST", InkPayload(job->payload), host, failed, 0, deadline);
+            job->timing.firstByteUs = micros();
+            backOff(job->endpoint, job->httpCode, http->header("Retry-After"));
+            if (job->httpCode <= 0 && expired(deadline))
+                job->status = "DEADLINE_EXCEEDED";
+            Serial.println(job->httpCode > 0 ? " [Streaming]" : " [Fatal]");
+        }
+    }
+
+    // The parser deletes the job once the ring is closed; keep what is needed after that
+    InkPriority priority = job->priority;
+    int httpCode = job->httpCode;
+    size_t sent = job->payload.length();
+    xQueueSend(_parseQueue, &job, portMAX_DELAY);
+    size_t received = 0;
+    if (httpCode > 0)
+    {
+        InkRingStream sink(_ring, _parseTask);
+        http->writeToStream(&sink);
+        received = sink.written();
+    }
+    job->timing.receivedUs = micros(); // published to the parser by close()
+    _ring.close();
+    xTaskNotifyGive(_parseTask);
+    job = nullptr;
+    if (httpCode > 0)
+        recordTraffic(sent, received);
+
+    if (http)
+    {
+        http->end();
+        dropHttp(http);
+    }
+    dropClient(client);
+    if (admitted)
+        releaseSlot(priority);
+    watchHeap();
+
+    // The ring is reused by the next transfer
+    xSemaphoreTake(_parseDone, portMAX_DELAY);
+}
+
+// Parser side: owns the job from here on and hands the result to the application.
+void InkBridge::parse(InkJob *job)
+{
+    Response response;
+    InkRingReader reader(_ring, _netTask);
+    DeserializationError error = DeserializationError::EmptyInput;
+    if (job->httpCode > 0)
+        error = deserializeJson(response.data, reader);
+    reader.drain();
+    job->timing.parsedUs = micros();
+    xSemaphoreGive(_parseDone);
+
+    response.status = job->status.length() > 0 ? job->status : requestStatus(job->httpCode, error);
+    if (job->httpCode > 0)
+        recordTiming(true, job->priority, job->timing);
+    if (response.status != "OK")
+        Serial.printf("[Ink] Pipeline %s: %s\n", job->endpoint.c_str(), response.status.c_str());
+
+    InkResult *result = new InkResult();
+    if (result)
+    {
+        result->tag = job->tag;
+        result->source = job->source;
+        result->timing = job->timing;
+    }
+
+#if INK_ENABLE_NEWS
+    if (job->source == INK_SOURCE_NEWS)
+        response = commitNews(job->key, std::move(response));
+#endif
+#if INK_ENABLE_CALENDAR
+    if (job->source == INK_SOURCE_CALENDAR)
+        response = commitCalendar(job->key, std::move(response));
+#endif
+    delete job;
+
+    if (!result)
+        return;
+    result->response = std::move(response);
+    if (xQueueSend(_resultQueue, &result, 0) != pdTRUE)
+    {
+        Serial.println("[Ink] Pipeline result queue full, result dropped");
+        delete result;
+    }
+}
+
+void InkBridge::recordTiming(bool pipelined, InkPriority priority, const InkTiming &timing)
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _statCount[pipelined]++;
+    _statLatencyUs[pipelined] += timing.parsedUs - timing.sentUs;
+    _statParseUs[pipelined] += timing.parsedUs - timing.receivedUs;
+
+    uint32_t wait = timing.sentUs - timing.queuedUs;
+    _waitCount[priority]++;
+    _waitTotalUs[priority] += wait;
+    if (wait > _waitMaxUs[priority])
+        _waitMaxUs[priority] = wait;
+}
+
+void InkBridge::recordTraffic(size_t sent, size_t received)
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _bytesSent += sent;
+    _bytesReceived += received;
+}
+
+InkLatencyStats InkBridge::getLatencyStats()
+{
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    InkLatencyStats stats = {};
+    stats.sequentialCount = _statCount[0];
+    stats.pipelinedCount = _statCount[1];
+    stats.bytesSent = _bytesSent;
+    stats.bytesReceived = _bytesReceived;
+    if (_statCount[0] > 0)
+    {
+        stats.sequentialAvgUs = _statLatencyUs[0] / _statCount[0];
+        stats.sequentialParseAvgUs = _statParseUs[0] / _statCount[0];
+    }
+    if (_statCount[1] > 0)
+    {
+        stats.pipelinedAvgUs = _statLatencyUs[1] / _statCount[1];
+        stats.pipelinedParseAvgUs = _statParseUs[1] / _statCount[1];
+    }
+    for (int i = 0; i < INK_PRIORITY_COUNT; i++)
+    {
+        stats.waitCount[i] = _waitCount[i];
+        stats.waitAvgUs[i] = _waitCount[i] > 0 ? _waitTotalUs[i] / _waitCount[i] : 0;
+        stats.waitMaxUs[i] = _waitMaxUs[i];
+    }
+    return stats;
+}
+
+bool InkBridge::registerDevice()
+{
+    Response response = sendRequest("/setup", "GET", "");
+    if (response.status != "OK")
+    {
+        Serial.println("[Ink] Payload empty check API connection");
+        return false;
+    }
+    JsonDocument &doc = response.data;
+
+    if (doc["status"] != "success")
+    {
+        Serial.println("[Ink] Registration Failed: " + doc["message"].as<String>());
+        return false;
+    }
+
+    InkLock lock(_locks[INK_SOURCE_CONFIG]);
+    _apiKey = doc["api_key"].as<String>();
+    _friendlyName = doc["friendly_user_id"].as<String>();
+    _uid = doc["uid"].as<String>();
+
+    NVSManager::saveApi(_apiKey, storage());
+    NVSManager::saveFriendlyUser(_friendlyName, storage());
+    NVSManager::saveUID(_uid, storage());
+
+    Serial.println("[Ink] Registration Successful! Linked to: " + _friendlyName);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Table-driven requests (the table itself is above the pipeline, which uses it)
+// ---------------------------------------------------------------------------
+
+// JSON body for an endpoint: identity plus one value per parameter, in table order
+InkPayload InkBridge::endpointPayload(const InkEndpoint &endpoint, const InkValue *values)
+{
+    JsonDocument doc(&InkPool::shared());
+    identify(doc);
+    for (int i = 0; i < endpoint.paramCount; i++)
+    {
+        const InkParam &param = endpoint.params[i];
+        if (param.kind == INK_PARAM_NUMBER)
+            doc[param.name] = values[i].number;
+        else if (param.kind == INK_PARAM_TEXT || values[i].text->length() > 0)
+            doc[param.name] = *values[i].text;
+    }
+    return InkPayload(doc);
+}
+
+Response InkBridge::callEndpoint(const InkEndpoint &endpoint, const InkValue *values)
+{
+    if (endpoint.fetch)
+        return endpoint.fetch(*this, values);
+    Response fresh = sendRequest(endpoint.path, "POST", endpointPayload(endpoint, values), endpoint.priority);
+    if (!endpoint.cache)
+        return fresh;
+    return store(endpoint.source, this->*endpoint.cache, std::move(fresh));
+}
+
+// The templates only pack arguments; everything else is shared code.
+template <typename... Args>
+Response InkBridge::call(const InkEndpoint &endpoint, const Args &...args)
+{
+    const InkValue values[sizeof...(Args) + 1] = {InkValue(args)..., InkValue(0)};
+    return callEndpoint(endpoint, values);
+}
+
+template <typename... Args>
+void InkBridge::ensure(const InkEndpoint &endpoint, const Args &...args)
+{
+    if (missing(endpoint.source, this->*endpoint.cache))
+        call(endpoint, args...);
+}
+
+// Walks a '.'-separated path of object keys below v
+static JsonVariantConst fieldAt(JsonVariantConst v, const char *path)
+{
+    char key[32];
+    while (*path && !v.isNull())
+    {
+        const char *dot = strchr(path, '.');
+        size_t len = dot ? dot - path : strlen(path);
+        if (len >= sizeof(key))
+            return JsonVariantConst();
+        memcpy(key, path, len);
+        key[len] = '\0';
+        v = v[key];
+        path += dot ? len + 1 : len;
+    }
+    return v;
+}
+
+// The accessors below fetch first if the cache is empty, then read under the source lock
+template <typename T, typename... Args>
+T InkBridge::field(const InkEndpoint &endpoint, const char *path, const Args &...args)
+{
+    ensure(endpoint, args...);
+    InkLock lock(_locks[endpoint.source]);
+    return fieldAt((this->*endpoint.cache).data.template as<JsonVariantConst>(), path).template as<T>();
+}
+
+template <typename T, typename... Args>
+T InkBridge::itemField(const InkEndpoint &endpoint, const char *list, int index, const char *path, const Args &...args)
+{
+    ensure(endpoint, args...);
+    InkLock lock(_locks[endpoint.source]);
+    JsonVariantConst item = (this->*endpoint.cache).data[list][index];
+    return fieldAt(item, path).template as<T>();
+}
+
+template <typename... Args>
+int InkBridge::listSize(const InkEndpoint &endpoint, const char *list, const Args &...args)
+{
+    ensure(endpoint, args...);
+    InkLock lock(_locks[endpoint.source]);
+    return (this->*endpoint.cache).data[list].size();
+}
+
+#if INK_ENABLE_CANVAS
+static JsonObject lookup(const InkIndex &index, int position)
+{
+    return index.at(position);
+}
+
+static JsonObject lookup(const InkIndex &index, const String &key)
+{
+    return index.find(key.c_str());
+}
+
+template <typename Key, typename... Args>
+Response InkBridge::indexRow(const InkEndpoint &endpoint, InkIndex InkBridge::*index, const Key &key, const Args &...args)
+{
+    ensure(endpoint, args...);
+    InkLock lock(_locks[endpoint.source]);
+    Response r;
+    r.status = "NOT_FOUND";
+    JsonObject row = lookup(this->*index, key);
+    if (!row.isNull())
+    {
+        r.data = row;
+        r.status = "OK";
+    }
+    return r;
+}
+
+template <typename T, typename Key, typename... Args>
+T InkBridge::indexField(const InkEndpoint &endpoint, InkIndex InkBridge::*index, const Key &key, const char *path, const Args &...args)
+{
+    ensure(endpoint, args...);
+    InkLock lock(_locks[endpoint.source]);
+    return fieldAt(lookup(this->*index, key), path).template as<T>();
+}
+#endif
+
+#if INK_ENABLE_WEATHER
+static void copyText(char *dst, size_t size, JsonVariantConst src)
+{
+    strlcpy(dst, src | "", size);
+}
+
+// Temperatures read the same from the structs and from the raw reply: "18", "18.43"
+static String floatText(float value)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%.6g", value);
+    return String(text);
+}
+
+static String numberText(JsonVariantConst src)
+{
+    return src.is<float>() ? floatText(src.as<float>()) : src.as<String>();
+}
+
+Response InkBridge::getWeather(String location)
+{
+    const InkValue values[] = {location};
+    Response fresh = sendRequest(EP_WEATHER.path, "POST", endpointPayload(EP_WEATHER, values), EP_WEATHER.priority);
+    WeatherNow decoded = {};
+    if (_decodeOnce && fresh.status == "OK")
+    {
+        decodeWeather(fresh, decoded);
+        fresh.data.clear();
+    }
+
+    InkLock lock(_locks[INK_SOURCE_WEATHER]);
+    if (!keepsCache(fresh))
+        decodedWeather = decoded;
+    return store(INK_SOURCE_WEATHER, weather, std::move(fresh));
+}
+
+void InkBridge::decodeWeather(const Response &response, WeatherNow &out)
+{
+    out.temperature = response.data["temperature"].as<float>();
+    copyText(out.condition, sizeof(out.condition), response.data["condition"]);
+    copyText(out.description, sizeof(out.description), response.data["description"]);
+    copyText(out.location, sizeof(out.location), response.data["location"]);
+    out.valid = true;
+}
+
+WeatherNow InkBridge::getWeatherNow(String location) {
+    if (missing(INK_SOURCE_WEATHER, weather, &decodedWeather.valid)) getWeather(location);
+    InkLock lock(_locks[INK_SOURCE_WEATHER]);
+    if (!decodedWeather.valid && weather.status == "OK") decodeWeather(weather, decodedWeather);
+    return decodedWeather;
+}
+
+double InkBridge::getWeatherTemperature(String location) {
+    if (missing(INK_SOURCE_WEATHER, weather, &decodedWeather.valid)) getWeather(location);
+    InkLock lock(_locks[INK_SOURCE_WEATHER]);
+    if (decodedWeather.valid) return decodedWeather.temperature;
+    return weather.data["temperature"].as<double>();
+}
+
+String InkBridge::getWeatherCondition(String location) {
+    if (missing(INK_SOURCE_WEATHER, weather, &decodedWeather.valid)) getWeather(location);
+    InkLock lock(_locks[INK_SOURCE_WEATHER]);
+    if (decodedWeather.valid) return String(decodedWeather.condition);
+    return weather.data["condition"].as<String>();
 }
 
 String InkBridge::getWeatherDescription(String location) {
-    if (weather.data.isNull()) getWeather(location);
+    if (missing(INK_SOURCE_WEATHER, weather, &decodedWeather.valid)) getWeather(location);
+    InkLock lock(_locks[INK_SOURCE_WEATHER]);
+    if (decodedWeather.valid) return String(decodedWeather.description);
     return weather.data["description"].as<String>();
 }
 
 String InkBridge::getWeatherLocation(String location) {
-    if (weather.data.isNull()) getWeather(location);
+    if (missing(INK_SOURCE_WEATHER, weather, &decodedWeather.valid)) getWeather(location);
+    InkLock lock(_locks[INK_SOURCE_WEATHER]);
+    if (decodedWeather.valid) return String(decodedWeather.location);
     return weather.data["location"].as<String>();
 }
 
 Response InkBridge::getWeatherForecast(String location, int days) {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    if (location != "") doc["location"] = location;
-    doc["days"] = days;
-    String json;
-    serializeJson(doc, json);
-    weatherForecast = sendRequest("/weather/forecast", "POST", json);
-    return weatherForecast;
+    const InkValue values[] = {location, days};
+    Response fresh = sendRequest(EP_FORECAST.path, "POST", endpointPayload(EP_FORECAST, values), EP_FORECAST.priority);
+    WeatherForecast decoded = {};
+    if (_decodeOnce && fresh.status == "OK")
+    {
+        decodeForecast(fresh, decoded);
+        fresh.data.clear();
+    }
+
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (!keepsCache(fresh))
+        decodedForecast = decoded;
+    return store(INK_SOURCE_FORECAST, weatherForecast, std::move(fresh));
+}
+
+void InkBridge::decodeForecast(const Response &response, WeatherForecast &out)
+{
+    copyText(out.location, sizeof(out.location), response.data["location"]);
+    copyText(out.trend, sizeof(out.trend), response.data["trend"]);
+    out.count = 0;
+    JsonArray arr = response.data["forecast"];
+    for (JsonVariant v : arr) {
+        if (out.count >= INK_MAX_FORECAST_DAYS) break;
+        ForecastDay &day = out.days[out.count++];
+        copyText(day.date, sizeof(day.date), v["date"]);
+        day.minTemp = v["min_temp"].as<float>();
+        day.maxTemp = v["max_temp"].as<float>();
+        copyText(day.condition, sizeof(day.condition), v["condition"]);
+    }
+    out.valid = true;
+}
+
+int InkBridge::findForecastDay(const String &date) {
+    for (int i = 0; i < decodedForecast.count; i++) {
+        if (date == decodedForecast.days[i].date) return i;
+    }
+    return -1;
+}
+
+WeatherForecast InkBridge::getWeatherForecastDays(String location, int days) {
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (!decodedForecast.valid && weatherForecast.status == "OK") decodeForecast(weatherForecast, decodedForecast);
+    return decodedForecast;
 }
 
 int InkBridge::getWeatherForcastDayCount(String location, int days) {
-    if (weatherForecast.data.isNull()) getWeatherForecast(location, days);
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (decodedForecast.valid) return decodedForecast.count;
     return weatherForecast.data["forecast"].size();
 }
 
 String InkBridge::getWeatherForcastLocation(String location, int days) {
-    if (weatherForecast.data.isNull()) getWeatherForecast(location, days);
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (decodedForecast.valid) return String(decodedForecast.location);
     return weatherForecast.data["location"].as<String>();
 }
 
 String InkBridge::getWeatherForecastDate(int index, String location, int days) {
-    if (weatherForecast.data.isNull()) getWeatherForecast(location, days);
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (decodedForecast.valid) return index >= 0 && index < decodedForecast.count ? String(decodedForecast.days[index].date) : String("");
     return weatherForecast.data["forecast"][index]["date"].as<String>();
 }
 
 String InkBridge::getWeatherForecastMinTemp(int index, String location, int days) {
-    if (weatherForecast.data.isNull()) getWeatherForecast(location, days);
-    return weatherForecast.data["forecast"][index]["min_temp"].as<String>();
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (decodedForecast.valid) return index >= 0 && index < decodedForecast.count ? floatText(decodedForecast.days[index].minTemp) : String("");
+    return numberText(weatherForecast.data["forecast"][index]["min_temp"]);
 }
 
 String InkBridge::getWeatherForecastMaxTemp(int index, String location, int days) {
-    if (weatherForecast.data.isNull()) getWeatherForecast(location, days);
-    return weatherForecast.data["forecast"][index]["max_temp"].as<String>();
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (decodedForecast.valid) return index >= 0 && index < decodedForecast.count ? floatText(decodedForecast.days[index].maxTemp) : String("");
+    return numberText(weatherForecast.data["forecast"][index]["max_temp"]);
 }
 
 String InkBridge::getWeatherForecastCondition(int index, String location, int days) {
-    if (weatherForecast.data.isNull()) getWeatherForecast(location, days);
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (decodedForecast.valid) return index >= 0 && index < decodedForecast.count ? String(decodedForecast.days[index].condition) : String("");
     return weatherForecast.data["forecast"][index]["condition"].as<String>();
 }
 
 String InkBridge::getWeatherForcastTrend(String location, int days) {
-    if (weatherForecast.data.isNull()) getWeatherForecast(location, days);
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (decodedForecast.valid) return String(decodedForecast.trend);
     return weatherForecast.data["trend"].as<String>();
 }
 
 // Overloads for searching by date
 String InkBridge::getWeatherForecastMinTemp(String date, String location, int days) {
-    if (weatherForecast.data.isNull()) getWeatherForecast(location, days);
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (decodedForecast.valid) {
+        int i = findForecastDay(date);
+        return i < 0 ? String("") : floatText(decodedForecast.days[i].minTemp);
+    }
     JsonArray arr = weatherForecast.data["forecast"];
     for (JsonVariant v : arr) {
-        if (v["date"].as<String>() == date) return v["min_temp"].as<String>();
+        if (v["date"].as<String>() == date) return numberText(v["min_temp"]);
     }
     return "";
 }
 
 String InkBridge::getWeatherForecastMaxTemp(String date, String location, int days) {
-    if (weatherForecast.data.isNull()) getWeatherForecast(location, days);
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (decodedForecast.valid) {
+        int i = findForecastDay(date);
+        return i < 0 ? String("") : floatText(decodedForecast.days[i].maxTemp);
+    }
+    JsonArray arr = weatherForecast.data["forecast"];
+    for (JsonVariant v : arr) {
+        if (v["date"].as<String>() == date) return numberText(v["max_temp"]);
+    }
+    return "";
+}
+
+String InkBridge::getWeatherForecastCondition(String date, String location, int days) {
+    if (missing(INK_SOURCE_FORECAST, weatherForecast, &decodedForecast.valid)) getWeatherForecast(location, days);
+    InkLock lock(_locks[INK_SOURCE_FORECAST]);
+    if (decodedForecast.valid) {
+        int i = findForecastDay(date);
+        return i < 0 ? String("") : String(decodedForecast.days[i].condition);
+    }
     JsonArray arr = weatherForecast.data["forecast"];
     for (JsonVariant v : arr) {
-        if (v["date"].as<String>() == date) return v["max_temp"].as<String>();
+        if (v["date"].as<String>() == date) return v["condition"].as<String>();
+    }
+    return "";
+}
+
+Response InkBridge::getWeatherHistory(String location, String date) {
+    return fetchHistory(location, date, "");
+}
+
+Response InkBridge::fetchHistory(const String &location, const String &date, const String &endDate)
+{
+    const InkValue values[] = {location, date, endDate};
+    Response fresh = sendRequest(EP_HISTORY.path, "POST", endpointPayload(EP_HISTORY, values), EP_HISTORY.priority);
+    if (fresh.status == "OK")
+        mergeHistory(location, fresh);
+    WeatherHistory decoded = {};
+    if (_decodeOnce && fresh.status == "OK")
+    {
+        decodeHistory(fresh, decoded);
+        fresh.data.clear();
+    }
+
+    InkLock lock(_locks[INK_SOURCE_HISTORY]);
+    if (!keepsCache(fresh))
+        decodedHistory = decoded;
+    return store(INK_SOURCE_HISTORY, weatherHistory, std::move(fresh));
+}
+
+void InkBridge::decodeHistory(const Response &response, WeatherHistory &out)
+{
+    copyText(out.location, sizeof(out.location), response.data["location"]);
+    copyText(out.trend, sizeof(out.trend), response.data["trend"]);
+    out.count = 0;
+    JsonArray arr = response.data["history"];
+    for (JsonVariant v : arr) {
+        if (out.count >= INK_MAX_HISTORY_DAYS) break;
+        HistoryDay &day = out.days[out.count++];
+        copyText(day.date, sizeof(day.date), v["date"]);
+        day.avgTemp = v["avg_temp"].as<float>();
+        copyText(day.condition, sizeof(day.condition), v["condition"]);
+    }
+    out.valid = true;
+}
+
+int32_t InkBridge::historyToday()
+{
+    time_t now = time(nullptr);
+    if (now <= 100000)
+        return -1;
+    struct tm local;
+    char date[11];
+    localtime_r(&now, &local);
+    strftime(date, sizeof(date), "%Y-%m-%d", &local);
+    return InkHistoryStore::dayNumber(date);
+}
+
+// Makes _history hold the given location, loading it from NVS on a change.
+// Callers hold the history lock.
+void InkBridge::selectHistory(const String &location)
+{
+    if (_historyLoaded && location == _history.location())
+        return;
+    _history.load(location.c_str(), storage());
+    _historyLoaded = true;
+    for (int i = 0; i < INK_HISTORY_PROBES; i++)
+        _historyProbes[i].used = false;
+}
+
+InkBridge::HistoryProbe *InkBridge::findProbe(int32_t day)
+{
+    for (int i = 0; i < INK_HISTORY_PROBES; i++)
+    {
+        if (_historyProbes[i].used && _historyProbes[i].record.day == day)
+            return &_historyProbes[i];
+    }
+    return nullptr;
+}
+
+// Records a request for day; record is its value from the reply, nullptr if the
+// reply did not have it. Callers hold the history lock.
+InkBridge::HistoryProbe *InkBridge::noteProbe(int32_t day, const InkHistoryStore::Day *record)
+{
+    HistoryProbe *probe = findProbe(day);
+    if (!probe)
+    {
+        probe = &_historyProbes[_historyProbeNext];
+        _historyProbeNext = (_historyProbeNext + 1) % INK_HISTORY_PROBES;
+    }
+    probe->used = true;
+    probe->found = record != nullptr;
+    probe->at = millis();
+    if (record)
+        probe->record = *record;
+    else
+        probe->record.day = (uint16_t)day;
+    return probe;
+}
+
+// Adds the days of a /weather/history reply to the store. Today is not stored
+// because its weather is not final yet; it is kept as a probe instead.
+void InkBridge::mergeHistory(const String &location, const Response &fresh)
+{
+    int32_t today = historyToday();
+    InkLock lock(_locks[INK_SOURCE_HISTORY]);
+    selectHistory(location);
+    bool changed = false;
+    for (JsonVariantConst v : fresh.data["history"].as<JsonArrayConst>())
+    {
+        const char *date = v["date"] | "";
+        int32_t day = InkHistoryStore::dayNumber(date);
+        if (day < 0)
+            continue;
+        if (today >= 0 && day >= today)
+        {
+            InkHistoryStore::Day record;
+            record.day = (uint16_t)day;
+            record.avgTemp = (int16_t)lroundf(v["avg_temp"].as<float>() * 10.0f);
+            strlcpy(record.condition, v["condition"] | "", sizeof(record.condition));
+            noteProbe(day, &record);
+            continue;
+        }
+        changed |= _history.put(date, v["avg_temp"].as<float>(), v["condition"] | "");
+    }
+    if (changed)
+        _history.save(storage());
+}
+
+// Reads a day from the store. A date it does not hold is requested at most once
+// per INK_HISTORY_RETRY_MS, since the helpers are typically called every frame.
+bool InkBridge::historyDay(const String &date, const String &location, InkHistoryStore::Day &out)
+{
+    int32_t day = InkHistoryStore::dayNumber(date.c_str());
+    if (day < 0)
+        return false;
+    {
+        InkLock lock(_locks[INK_SOURCE_HISTORY]);
+        selectHistory(location);
+        int i = _history.find(day);
+        if (i >= 0)
+        {
+            out = _history.at(i);
+            return true;
+        }
+        const HistoryProbe *probe = findProbe(day);
+        if (probe && millis() - probe->at < INK_HISTORY_RETRY_MS)
+        {
+            if (probe->found)
+                out = probe->record;
+            return probe->found;
+        }
+    }
+    getWeatherHistory(location, date);
+    InkLock lock(_locks[INK_SOURCE_HISTORY]);
+    selectHistory(location);
+    int i = _history.find(day);
+    if (i >= 0)
+    {
+        out = _history.at(i);
+        return true;
+    }
+    // mergeHistory() has just noted today; anything else the reply lacked
+    const HistoryProbe *probe = findProbe(day);
+    if (!probe || millis() - probe->at >= INK_HISTORY_RETRY_MS)
+        probe = noteProbe(day, nullptr);
+    if (probe->found)
+        out = probe->record;
+    return probe->found;
+}
+
+int InkBridge::fetchWeatherHistoryRange(String from, String to, String location)
+{
+    int32_t first = InkHistoryStore::dayNumber(from.c_str());
+    int32_t last = InkHistoryStore::dayNumber(to.c_str());
+    int32_t today = historyToday();
+    if (today >= 0 && last >= today)
+        last = today - 1;
+    if (first < 0 || last < first)
+        return 0;
+
+    // One request per missing run. A server that ignores end_date still returns
+    // its usual window around date; stop once a request adds nothing new.
+    int32_t gapFrom, gapTo;
+    for (int requests = 0; requests < INK_HISTORY_CAPACITY; requests++)
+    {
+        {
+            InkLock lock(_locks[INK_SOURCE_HISTORY]);
+            selectHistory(location);
+            if (!_history.gap(first, last, gapFrom, gapTo))
+                break;
+        }
+        char startDate[11], endDate[11];
+        InkHistoryStore::formatDay(gapFrom, startDate, sizeof(startDate));
+        InkHistoryStore::formatDay(gapTo, endDate, sizeof(endDate));
+        if (fetchHistory(location, startDate, endDate).status != "OK")
+            break;
+
+        InkLock lock(_locks[INK_SOURCE_HISTORY]);
+        int32_t nextFrom, nextTo;
+        if (_history.gap(first, last, nextFrom, nextTo) && nextFrom == gapFrom)
+            break;
+    }
+
+    InkLock lock(_locks[INK_SOURCE_HISTORY]);
+    selectHistory(location);
+    int stored = 0;
+    for (int32_t day = first; day <= last; day++)
+        stored += _history.find(day) >= 0;
+    return stored;
+}
+
+WeatherHistory InkBridge::getWeatherHistoryDays(String location, String date) {
+    if (missing(INK_SOURCE_HISTORY, weatherHistory, &decodedHistory.valid)) getWeatherHistory(location, date);
+    InkLock lock(_locks[INK_SOURCE_HISTORY]);
+    if (!decodedHistory.valid && weatherHistory.status == "OK") decodeHistory(weatherHistory, decodedHistory);
+    return decodedHistory;
+}
+
+// ... (Implement history helpers similarly if needed, skipping for brevity based on pattern)
+// Note: The prompt asked for "all", but to keep the response length manageable I will implement the key ones requested in header.
+
+Response InkBridge::getAstronomy(String location) {
+    Response local;
+    if (computeAstronomy(location, local))
+        return local;
+
+    const InkValue values[] = {location};
+    Response fresh = sendRequest(EP_ASTRONOMY.path, "POST", endpointPayload(EP_ASTRONOMY, values), EP_ASTRONOMY.priority);
+    if (fresh.status == "OK")
+        learnSite(location, fresh.data.as<JsonVariantConst>());
+    Astronomy decoded = {};
+    if (_decodeOnce && fresh.status == "OK")
+    {
+        decodeAstronomy(fresh, decoded);
+        fresh.data.clear();
+    }
+
+    InkLock lock(_locks[INK_SOURCE_ASTRONOMY]);
+    if (!keepsCache(fresh))
+        decodedAstronomy = decoded;
+    return store(INK_SOURCE_ASTRONOMY, astronomy, std::move(fresh));
+}
+
+void InkBridge::decodeAstronomy(const Response &response, Astronomy &out)
+{
+    copyText(out.sunrise, sizeof(out.sunrise), response.data["sunrise"]);
+    copyText(out.sunset, sizeof(out.sunset), response.data["sunset"]);
+    copyText(out.moonrise, sizeof(out.moonrise), response.data["moonrise"]);
+    copyText(out.moonset, sizeof(out.moonset), response.data["moonset"]);
+    copyText(out.location, sizeof(out.location), response.data["location"]);
+    copyText(out.moonPhase, sizeof(out.moonPhase), response.data["moon_phase"]);
+    out.moonIllumination = response.data["moon_illumination"].as<int>();
+    out.isDaytime = response.data["is_daytime"].as<bool>();
+    out.valid = true;
+}
+
+void InkBridge::setAstronomyCoordinates(double lat, double lon, String location, String name)
+{
+    JsonDocument doc(&InkPool::shared());
+    doc["lat"] = lat;
+    doc["lon"] = lon;
+    doc["location"] = name != "" ? name : location;
+    learnSite(location, doc.as<JsonVariantConst>());
+}
+
+void InkBridge::setLocalAstronomy(bool enabled)
+{
+    InkLock lock(_locks[INK_SOURCE_ASTRONOMY]);
+    _localAstronomy = enabled;
+}
+
+int InkBridge::findSite(const String &location)
+{
+    for (int i = 0; i < _siteCount; i++)
+        if (location == _sites[i].key)
+            return i;
+    return -1;
+}
+
+// Remembers the coordinates in an astronomy reply so later calls for the same
+// location string never leave the device. Accepts lat/lon, latitude/longitude
+// or a nested "coord" object; replies without them change nothing.
+void InkBridge::learnSite(const String &location, JsonVariantConst data)
+{
+    JsonVariantConst coord = data["coord"].is<JsonObjectConst>() ? data["coord"] : data;
+    JsonVariantConst lat = coord["lat"].is<double>() ? coord["lat"] : coord["latitude"];
+    JsonVariantConst lon = coord["lon"].is<double>() ? coord["lon"] : coord["longitude"];
+    if (!lat.is<double>() || !lon.is<double>())
+        return;
+
+    InkLock lock(_locks[INK_SOURCE_ASTRONOMY]);
+    int i = findSite(location);
+    if (i < 0)
+    {
+        if (_siteCount < INK_MAX_SITES)
+            i = _siteCount++;
+        else
+        {
+            i = _siteNext;
+            _siteNext = (_siteNext + 1) % INK_MAX_SITES;
+        }
+    }
+    AstronomySite &site = _sites[i];
+    strlcpy(site.key, location.c_str(), sizeof(site.key));
+    copyText(site.name, sizeof(site.name), data["location"]);
+    site.lat = lat.as<double>();
+    site.lon = lon.as<double>();
+    Serial.printf("[Ink] Astronomy for '%s' now computed locally (%.4f, %.4f)\n", site.key, site.lat, site.lon);
+}
+
+static void formatClock(char *dst, size_t size, time_t when)
+{
+    struct tm local;
+    if (when == 0)
+    {
+        strlcpy(dst, "--:--", size); // no rise or set on this day
+        return;
+    }
+    localtime_r(&when, &local);
+    strftime(dst, size, "%I:%M %p", &local);
+}
+
+// Builds the /weather/astronomy reply on the device. Needs known coordinates for
+// the location and a synced clock; returns false to fall back to the server.
+bool InkBridge::computeAstronomy(const String &location, Response &out)
+{
+    time_t now = time(nullptr);
+    if (now <= 100000)
+        return false;
+
+    AstronomySite site;
+    {
+        InkLock lock(_locks[INK_SOURCE_ASTRONOMY]);
+        int i = findSite(location);
+        if (!_localAstronomy || i < 0)
+            return false;
+        site = _sites[i];
     }
-    return "";
-}
 
-String InkBridge::getWeatherForecastCondition(String date, String location, int days) {
-    if (weatherForecast.data.isNull()) getWeatherForecast(location, days);
-    JsonArray arr = weatherForecast.data["forecast"];
-    for (JsonVariant v : arr) {
-        if (v["date"].as<String>() == date) return v["condition"].as<String>();
+    InkAstronomy::Events events = InkAstronomy::events(site.lat, site.lon, now);
+    Astronomy decoded = {};
+    formatClock(decoded.sunrise, sizeof(decoded.sunrise), events.sunrise);
+    formatClock(decoded.sunset, sizeof(decoded.sunset), events.sunset);
+    formatClock(decoded.moonrise, sizeof(decoded.moonrise), events.moonrise);
+    formatClock(decoded.moonset, sizeof(decoded.moonset), events.moonset);
+    strlcpy(decoded.location, site.name, sizeof(decoded.location));
+    strlcpy(decoded.moonPhase, InkAstronomy::moonPhaseName(now), sizeof(decoded.moonPhase));
+    decoded.moonIllumination = InkAstronomy::moonIllumination(now);
+    decoded.isDaytime = InkAstronomy::isDaytime(site.lat, site.lon, now);
+    decoded.valid = true;
+
+    Response fresh;
+    fresh.status = "OK";
+    if (!_decodeOnce)
+    {
+        fresh.data["location"] = decoded.location;
+        fresh.data["sunrise"] = decoded.sunrise;
+        fresh.data["sunset"] = decoded.sunset;
+        fresh.data["moonrise"] = decoded.moonrise;
+        fresh.data["moonset"] = decoded.moonset;
+        fresh.data["moon_phase"] = decoded.moonPhase;
+        fresh.data["moon_illumination"] = decoded.moonIllumination;
+        fresh.data["is_daytime"] = decoded.isDaytime;
+        fresh.data["lat"] = site.lat;
+        fresh.data["lon"] = site.lon;
     }
-    return "";
-}
 
-Response InkBridge::getWeatherHistory(String location, String date) {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    if (location != "") doc["location"] = location;
-    if (date != "") doc["date"] = date;
-    String json;
-    serializeJson(doc, json);
-    weatherHistory = sendRequest("/weather/history", "POST", json);
-    return weatherHistory;
+    InkLock lock(_locks[INK_SOURCE_ASTRONOMY]);
+    decodedAstronomy = decoded;
+    out = store(INK_SOURCE_ASTRONOMY, astronomy, std::move(fresh));
+    return true;
 }
 
-// ... (Implement history helpers similarly if needed, skipping for brevity based on pattern)
-// Note: The prompt asked for "all", but to keep the response length manageable I will implement the key ones requested in header.
+Astronomy InkBridge::getAstronomyInfo(String location) {
+    if (missing(INK_SOURCE_ASTRONOMY, astronomy, &decodedAstronomy.valid)) getAstronomy(location);
+    InkLock lock(_locks[INK_SOURCE_ASTRONOMY]);
+    if (!decodedAstronomy.valid && astronomy.status == "OK") decodeAstronomy(astronomy, decodedAstronomy);
+    return decodedAstronomy;
+}
 
-Response InkBridge::getAstronomy(String location) {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    if (location != "") doc["location"] = location;
-    String json;
-    serializeJson(doc, json);
-    astronomy = sendRequest("/weather/astronomy", "POST", json);
-    return astronomy;
-}
-
-String InkBridge::getAstronomySunrise(String location) { if(astronomy.data.isNull()) getAstronomy(location); return astronomy.data["sunrise"].as<String>(); }
-String InkBridge::getAstronomySunset(String location) { if(astronomy.data.isNull()) getAstronomy(location); return astronomy.data["sunset"].as<String>(); }
-String InkBridge::getAstronomyMoonrise(String location) { if(astronomy.data.isNull()) getAstronomy(location); return astronomy.data["moonrise"].as<String>(); }
-String InkBridge::getAstronomyMoonset(String location) { if(astronomy.data.isNull()) getAstronomy(location); return astronomy.data["moonset"].as<String>(); }
-String InkBridge::getAstronomyLocation(String location) { if(astronomy.data.isNull()) getAstronomy(location); return astronomy.data["location"].as<String>(); }
-String InkBridge::getAstronomyMoonPhase(String location) { if(astronomy.data.isNull()) getAstronomy(location); return astronomy.data["moon_phase"].as<String>(); }
-int InkBridge::getAstronomyMoonIllumination(String location) { if(astronomy.data.isNull()) getAstronomy(location); return astronomy.data["moon_illumination"].as<int>(); }
-bool InkBridge::getAstronomyIsDaytime(String location) { if(astronomy.data.isNull()) getAstronomy(location); return astronomy.data["is_daytime"].as<bool>(); }
+String InkBridge::getAstronomySunrise(String location) { if (missing(INK_SOURCE_ASTRONOMY, astronomy, &decodedAstronomy.valid)) getAstronomy(location); InkLock lock(_locks[INK_SOURCE_ASTRONOMY]); if(decodedAstronomy.valid) return String(decodedAstronomy.sunrise); return astronomy.data["sunrise"].as<String>(); }
+String InkBridge::getAstronomySunset(String location) { if (missing(INK_SOURCE_ASTRONOMY, astronomy, &decodedAstronomy.valid)) getAstronomy(location); InkLock lock(_locks[INK_SOURCE_ASTRONOMY]); if(decodedAstronomy.valid) return String(decodedAstronomy.sunset); return astronomy.data["sunset"].as<String>(); }
+String InkBridge::getAstronomyMoonrise(String location) { if (missing(INK_SOURCE_ASTRONOMY, astronomy, &decodedAstronomy.valid)) getAstronomy(location); InkLock lock(_locks[INK_SOURCE_ASTRONOMY]); if(decodedAstronomy.valid) return String(decodedAstronomy.moonrise); return astronomy.data["moonrise"].as<String>(); }
+String InkBridge::getAstronomyMoonset(String location) { if (missing(INK_SOURCE_ASTRONOMY, astronomy, &decodedAstronomy.valid)) getAstronomy(location); InkLock lock(_locks[INK_SOURCE_ASTRONOMY]); if(decodedAstronomy.valid) return String(decodedAstronomy.moonset); return astronomy.data["moonset"].as<String>(); }
+String InkBridge::getAstronomyLocation(String location) { if (missing(INK_SOURCE_ASTRONOMY, astronomy, &decodedAstronomy.valid)) getAstronomy(location); InkLock lock(_locks[INK_SOURCE_ASTRONOMY]); if(decodedAstronomy.valid) return String(decodedAstronomy.location); return astronomy.data["location"].as<String>(); }
+String InkBridge::getAstronomyMoonPhase(String location) { if (missing(INK_SOURCE_ASTRONOMY, astronomy, &decodedAstronomy.valid)) getAstronomy(location); InkLock lock(_locks[INK_SOURCE_ASTRONOMY]); if(decodedAstronomy.valid) return String(decodedAstronomy.moonPhase); return astronomy.data["moon_phase"].as<String>(); }
+int InkBridge::getAstronomyMoonIllumination(String location) { if (missing(INK_SOURCE_ASTRONOMY, astronomy, &decodedAstronomy.valid)) getAstronomy(location); InkLock lock(_locks[INK_SOURCE_ASTRONOMY]); if(decodedAstronomy.valid) return decodedAstronomy.moonIllumination; return astronomy.data["moon_illumination"].as<int>(); }
+bool InkBridge::getAstronomyIsDaytime(String location) { if (missing(INK_SOURCE_ASTRONOMY, astronomy, &decodedAstronomy.valid)) getAstronomy(location); InkLock lock(_locks[INK_SOURCE_ASTRONOMY]); if(decodedAstronomy.valid) return decodedAstronomy.isDaytime; return astronomy.data["is_daytime"].as<bool>(); }
 
 // Missing History Helpers Implementation
-int InkBridge::getWeatherHistoryCount(String location, String date) { if(weatherHistory.data.isNull()) getWeatherHistory(location, date); return weatherHistory.data["history"].size(); }
-String InkBridge::getWeatherHistoryLocation(String location, String date) { if(weatherHistory.data.isNull()) getWeatherHistory(location, date); return weatherHistory.data["location"].as<String>(); }
-String InkBridge::getWeatherHistoryDate(int index, String location, String date) { if(weatherHistory.data.isNull()) getWeatherHistory(location, date); return weatherHistory.data["history"][index]["date"].as<String>(); }
-String InkBridge::getWeatherHistoryAvgTemp(int index, String location, String date) { if(weatherHistory.data.isNull()) getWeatherHistory(location, date); return weatherHistory.data["history"][index]["avg_temp"].as<String>(); }
-String InkBridge::getWeatherHistoryCondition(int index, String location, String date) { if(weatherHistory.data.isNull()) getWeatherHistory(location, date); return weatherHistory.data["history"][index]["condition"].as<String>(); }
-String InkBridge::getWeatherHistoryTrend(String location, String date) { if(weatherHistory.data.isNull()) getWeatherHistory(location, date); return weatherHistory.data["trend"].as<String>(); }
+int InkBridge::getWeatherHistoryCount(String location, String date) { if (missing(INK_SOURCE_HISTORY, weatherHistory, &decodedHistory.valid)) getWeatherHistory(location, date); InkLock lock(_locks[INK_SOURCE_HISTORY]); if(decodedHistory.valid) return decodedHistory.count; return weatherHistory.data["history"].size(); }
+String InkBridge::getWeatherHistoryLocation(String location, String date) { if (missing(INK_SOURCE_HISTORY, weatherHistory, &decodedHistory.valid)) getWeatherHistory(location, date); InkLock lock(_locks[INK_SOURCE_HISTORY]); if(decodedHistory.valid) return String(decodedHistory.location); return weatherHistory.data["location"].as<String>(); }
+String InkBridge::getWeatherHistoryDate(int index, String location, String date) { if (missing(INK_SOURCE_HISTORY, weatherHistory, &decodedHistory.valid)) getWeatherHistory(location, date); InkLock lock(_locks[INK_SOURCE_HISTORY]); if(decodedHistory.valid) return index >= 0 && index < decodedHistory.count ? String(decodedHistory.days[index].date) : String(""); return weatherHistory.data["history"][index]["date"].as<String>(); }
+String InkBridge::getWeatherHistoryAvgTemp(int index, String location, String date) { if (missing(INK_SOURCE_HISTORY, weatherHistory, &decodedHistory.valid)) getWeatherHistory(location, date); InkLock lock(_locks[INK_SOURCE_HISTORY]); if(decodedHistory.valid) return index >= 0 && index < decodedHistory.count ? floatText(decodedHistory.days[index].avgTemp) : String(""); return numberText(weatherHistory.data["history"][index]["avg_temp"]); }
+String InkBridge::getWeatherHistoryCondition(int index, String location, String date) { if (missing(INK_SOURCE_HISTORY, weatherHistory, &decodedHistory.valid)) getWeatherHistory(location, date); InkLock lock(_locks[INK_SOURCE_HISTORY]); if(decodedHistory.valid) return index >= 0 && index < decodedHistory.count ? String(decodedHistory.days[index].condition) : String(""); return weatherHistory.data["history"][index]["condition"].as<String>(); }
+String InkBridge::getWeatherHistoryTrend(String location, String date) { if (missing(INK_SOURCE_HISTORY, weatherHistory, &decodedHistory.valid)) getWeatherHistory(location, date); InkLock lock(_locks[INK_SOURCE_HISTORY]); if(decodedHistory.valid) return String(decodedHistory.trend); return weatherHistory.data["trend"].as<String>(); }
 
 String InkBridge::getWeatherHistoryAvgTemp(String date, String location) {
-    if (weatherHistory.data.isNull()) getWeatherHistory(location, date);
-    JsonArray arr = weatherHistory.data["history"];
-    for (JsonVariant v : arr) if (v["date"].as<String>() == date) return v["avg_temp"].as<String>();
-    return "";
+    InkHistoryStore::Day day;
+    return historyDay(date, location, day) ? floatText(day.avgTemp / 10.0f) : String("");
 }
 String InkBridge::getWeatherHistoryCondition(String date, String location) {
-    if (weatherHistory.data.isNull()) getWeatherHistory(location, date);
-    JsonArray arr = weatherHistory.data["history"];
-    for (JsonVariant v : arr) if (v["date"].as<String>() == date) return v["condition"].as<String>();
-    return "";
+    InkHistoryStore::Day day;
+    return historyDay(date, location, day) ? String(day.condition) : String("");
 }
 #endif
 
-#if INK_ENABLE_STOCKS
-Response InkBridge::getStock(String symbol)
+#if INK_ENABLE_STOCKS || INK_ENABLE_CRYPTO
+// Days since 1970-01-01 for a proleptic Gregorian date
+static long daysFromCivil(int y, unsigned m, unsigned d)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    if (symbol != "")
-        doc["symbol"] = symbol;
+    y -= m <= 2;
+    long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long)doe - 719468;
+}
+
+// Accepts either bare numbers or objects with a price ("price"/"close"/"value")
+// and a time ("timestamp"/"time" in s or ms, or "date" as YYYY-MM-DD).
+static bool seriesPoint(JsonVariantConst v, uint32_t &time, double &value)
+{
+    time = 0;
+    if (v.is<double>())
+    {
+        value = v.as<double>();
+        return true;
+    }
+    JsonVariantConst price = v["price"];
+    if (price.isNull()) price = v["close"];
+    if (price.isNull()) price = v["value"];
+    if (price.isNull())
+        return false;
+    value = price.as<double>();
 
-    String json;
-    serializeJson(doc, json);
-    stocks = sendRequest("/stock", "POST", json);
-    return stocks;
+    JsonVariantConst t = v["timestamp"];
+    if (t.isNull()) t = v["time"];
+    if (!t.isNull())
+    {
+        double secs = t.as<double>();
+        time = (uint32_t)(secs > 1e11 ? secs / 1000 : secs);
+    }
+    else
+    {
+        int y, m, d;
+        const char *date = v["date"] | "";
+        if (sscanf(date, "%d-%d-%d", &y, &m, &d) == 3)
+            time = (uint32_t)(daysFromCivil(y, m, d) * 86400L);
+    }
+    return true;
 }
 
-Response InkBridge::getStockArray(String symbol, int days)
+InkTimeSeries *InkBridge::updateSeries(const InkEndpoint &endpoint, InkTimeSeries *pool, uint8_t &next, String symbol, int days)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    if (symbol != "")
-        doc["symbol"] = symbol;
+    InkTimeSeries *series = nullptr;
+    uint32_t since = 0;
+    {
+        InkLock lock(_locks[endpoint.source]);
+        for (int i = 0; i < INK_MAX_SERIES; i++)
+        {
+            if (symbol == pool[i].symbol())
+            {
+                series = &pool[i];
+                break;
+            }
+        }
+        if (!series)
+        {
+            series = &pool[next];
+            next = (next + 1) % INK_MAX_SERIES;
+            series->reset(symbol.c_str());
+        }
+        if (series->size() > 0)
+            since = series->lastTime();
+    }
+
+    JsonDocument doc(&InkPool::shared());
+    identify(doc);
+    doc["symbol"] = symbol;
     doc["days"] = days;
+    if (since != 0)
+        doc["since"] = since;
 
-    String json;
-    serializeJson(doc, json);
-    stocks = sendRequest("/stock/array", "POST", json);
-    return stocks;
-}
+    Response response = sendRequest(endpoint.path, "POST", InkPayload(doc), endpoint.priority);
+    if (response.status != "OK")
+        return series;
 
-double InkBridge::getStockPrice(String symbol) {
-    if (stocks.data.isNull()) getStock(symbol);
-    return stocks.data["price"].as<double>();
-}
-double InkBridge::getStockPercent(String symbol) {
-    if (stocks.data.isNull()) getStock(symbol);
-    return stocks.data["change_percent"].as<double>();
+    JsonArray arr = response.data.is<JsonArray>() ? response.data.as<JsonArray>() : response.data["prices"].as<JsonArray>();
+    if (arr.isNull())
+        arr = response.data["history"];
+
+    InkLock lock(_locks[endpoint.source]);
+    if (symbol != series->symbol())
+        return series; // slot was recycled for another symbol meanwhile
+
+    // Without timestamps there is nothing to merge against, so start over
+    uint32_t time;
+    double value;
+    if (arr.size() > 0 && seriesPoint(arr[0], time, value) && time == 0)
+        series->reset(symbol.c_str());
+
+    for (JsonVariant v : arr)
+    {
+        if (seriesPoint(v, time, value))
+            series->append(time, value);
+    }
+    return series;
 }
-String InkBridge::getStockSymbol(String symbol) {
-    if (stocks.data.isNull()) getStock(symbol);
-    return stocks.data["symbol"].as<String>();
+
+#endif
+
+#if INK_ENABLE_STOCKS
+Response InkBridge::getStock(String symbol)
+{
+    return call(EP_STOCK, symbol);
 }
-double InkBridge::getStockHigh(String symbol) {
-    if (stocks.data.isNull()) getStock(symbol);
-    return stocks.data["day_high"].as<double>();
+
+Response InkBridge::getStockArray(String symbol, int days)
+{
+    return call(EP_STOCK_ARRAY, symbol, days);
 }
-double InkBridge::getStockLow(String symbol) {
-    if (stocks.data.isNull()) getStock(symbol);
-    return stocks.data["day_low"].as<double>();
+
+InkTimeSeries *InkBridge::getStockSeries(String symbol, int days)
+{
+    return updateSeries(EP_STOCK_ARRAY, _stockSeries, _stockSeriesNext, symbol, days);
 }
+
+double InkBridge::getStockPrice(String symbol) { return field<double>(EP_STOCK, "price", symbol); }
+double InkBridge::getStockPercent(String symbol) { return field<double>(EP_STOCK, "change_percent", symbol); }
+String InkBridge::getStockSymbol(String symbol) { return field<String>(EP_STOCK, "symbol", symbol); }
+double InkBridge::getStockHigh(String symbol) { return field<double>(EP_STOCK, "day_high", symbol); }
+double InkBridge::getStockLow(String symbol) { return field<double>(EP_STOCK, "day_low", symbol); }
 #endif
 
 #if INK_ENABLE_CRYPTO
 Response InkBridge::getCrypto(String symbol)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    if (symbol != "")
-        doc["symbol"] = symbol;
-
-    String json;
-    serializeJson(doc, json);
-    crypto = sendRequest("/crypto", "POST", json);
-    return crypto;
+    return call(EP_CRYPTO, symbol);
 }
 
 Response InkBridge::getCryptoArray(String symbol, int days)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    if (symbol != "")
-        doc["symbol"] = symbol;
-    doc["days"] = days;
-
-    String json;
-    serializeJson(doc, json);
-    crypto = sendRequest("/crypto/array", "POST", json);
-    return crypto;
+    return call(EP_CRYPTO_ARRAY, symbol, days);
 }
 
-double InkBridge::getCryptoPrice(String symbol) {
-    if (crypto.data.isNull()) getCrypto(symbol);
-    return crypto.data["price"].as<double>();
-}
-double InkBridge::getCryptoPercent(String symbol) {
-    if (crypto.data.isNull()) getCrypto(symbol);
-    return crypto.data["change_percent"].as<double>();
-}
-String InkBridge::getCryptoSymbol(String symbol) {
-    if (crypto.data.isNull()) getCrypto(symbol);
-    return crypto.data["symbol"].as<String>();
-}
-String InkBridge::getCryptoName(String symbol) {
-    if (crypto.data.isNull()) getCrypto(symbol);
-    return crypto.data["name"].as<String>();
+InkTimeSeries *InkBridge::getCryptoSeries(String symbol, int days)
+{
+    return updateSeries(EP_CRYPTO_ARRAY, _cryptoSeries, _cryptoSeriesNext, symbol, days);
 }
+
+double InkBridge::getCryptoPrice(String symbol) { return field<double>(EP_CRYPTO, "price", symbol); }
+double InkBridge::getCryptoPercent(String symbol) { return field<double>(EP_CRYPTO, "change_percent", symbol); }
+String InkBridge::getCryptoSymbol(String symbol) { return field<String>(EP_CRYPTO, "symbol", symbol); }
+String InkBridge::getCryptoName(String symbol) { return field<String>(EP_CRYPTO, "name", symbol); }
 #endif
 
 #if INK_ENABLE_NEWS
-Response InkBridge::getNews(String category)
+InkPayload InkBridge::newsPayload(const String &category)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
+    JsonDocument doc(&InkPool::shared());
+    identify(doc);
     doc["category"] = category;
+    {
+        InkLock lock(_locks[INK_SOURCE_NEWS]);
+        if (_deltaSync && category == _newsSyncCategory && _newsSyncToken.length() > 0 && !news.data.isNull())
+            doc["sync_token"] = _newsSyncToken;
+    }
 
-    String json;
-    serializeJson(doc, json);
-    news = sendRequest("/news", "POST", json);
+    return InkPayload(doc);
+}
+
+Response InkBridge::commitNews(const String &category, Response &&fresh)
+{
+    if (!_deltaSync)
+    {
+        return store(INK_SOURCE_NEWS, news, std::move(fresh));
+    }
+
+    InkLock lock(_locks[INK_SOURCE_NEWS]);
+    if (category != _newsSyncCategory)
+        news.data.clear(); // a different category is a different local set
+    _newsSyncCategory = category;
+    applySync(news, fresh, "articles", "url", _newsSyncToken, _newsChanges);
     return news;
 }
 
-int InkBridge::getNewsArticleCount(String category) {
-    if (news.data.isNull()) getNews(category);
-    return news.data["articles"].size();
+Response InkBridge::getNews(String category)
+{
+    return commitNews(category, sendRequest(EP_NEWS.path, "POST", newsPayload(category), EP_NEWS.priority));
 }
-String InkBridge::getNewsArticleTitle(int index, String category) {
-    if (news.data.isNull()) getNews(category);
-    return news.data["articles"][index]["title"].as<String>();
+
+Response InkBridge::streamNews(String category, ItemCallback onArticle)
+{
+    const InkValue values[] = {category};
+    return streamList(EP_NEWS.path, endpointPayload(EP_NEWS, values), "articles", onArticle, EP_NEWS.priority);
 }
-String InkBridge::getNewsArticleSource(int index, String category) {
-    if (news.data.isNull()) getNews(category);
-    return news.data["articles"][index]["source"]["name"].as<String>();
+
+ChangeSet InkBridge::getNewsChanges() {
+    InkLock lock(_locks[INK_SOURCE_NEWS]);
+    return _newsChanges;
 }
+
+int InkBridge::getNewsArticleCount(String category) { return listSize(EP_NEWS, "articles", category); }
+String InkBridge::getNewsArticleTitle(int index, String category) { return itemField<String>(EP_NEWS, "articles", index, "title", category); }
+String InkBridge::getNewsArticleSource(int index, String category) { return itemField<String>(EP_NEWS, "articles", index, "source.name", category); }
 #endif
 
 #if INK_ENABLE_CALENDAR
-Response InkBridge::getCalendar(String range)
+InkPayload InkBridge::calendarPayload(const String &range)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
+    JsonDocument doc(&InkPool::shared());
+    identify(doc);
     doc["range"] = range;
+    {
+        InkLock lock(_locks[INK_SOURCE_CALENDAR]);
+        if (_deltaSync && range == _calendarSyncRange && _calendarSyncToken.length() > 0 && !calendar.data.isNull())
+            doc["sync_token"] = _calendarSyncToken;
+    }
 
-    String json;
-    serializeJson(doc, json);
-    calendar = sendRequest("/calendar", "POST", json);
-    return calendar;
+    return InkPayload(doc);
 }
 
-int InkBridge::getCalendarEventCount(String range) {
-    if (calendar.data.isNull()) getCalendar(range);
-    return calendar.data["events"].size();
+Response InkBridge::commitCalendar(const String &range, Response &&fresh)
+{
+    if (!_deltaSync)
+    {
+        return store(INK_SOURCE_CALENDAR, calendar, std::move(fresh));
+    }
+
+    InkLock lock(_locks[INK_SOURCE_CALENDAR]);
+    if (range != _calendarSyncRange)
+        calendar.data.clear();
+    _calendarSyncRange = range;
+    applySync(calendar, fresh, "events", "id", _calendarSyncToken, _calendarChanges);
+    return calendar;
 }
-String InkBridge::getCalendarEventTime(int index, String range) {
-    if (calendar.data.isNull()) getCalendar(range);
-    return calendar.data["events"][index]["start"].as<String>();
+
+Response InkBridge::getCalendar(String range)
+{
+    return commitCalendar(range, sendRequest(EP_CALENDAR.path, "POST", calendarPayload(range), EP_CALENDAR.priority));
 }
-String InkBridge::getCalendarEventTitle(int index, String range) {
-    if (calendar.data.isNull()) getCalendar(range);
-    return calendar.data["events"][index]["summary"].as<String>();
+
+Response InkBridge::streamCalendar(String range, ItemCallback onEvent)
+{
+    const InkValue values[] = {range};
+    return streamList(EP_CALENDAR.path, endpointPayload(EP_CALENDAR, values), "events", onEvent, EP_CALENDAR.priority);
 }
-String InkBridge::getCalendarEventLocation(int index, String range) {
-    if (calendar.data.isNull()) getCalendar(range);
-    return calendar.data["events"][index]["location"].as<String>();
+
+ChangeSet InkBridge::getCalendarChanges() {
+    InkLock lock(_locks[INK_SOURCE_CALENDAR]);
+    return _calendarChanges;
 }
+
+int InkBridge::getCalendarEventCount(String range) { return listSize(EP_CALENDAR, "events", range); }
+String InkBridge::getCalendarEventTime(int index, String range) { return itemField<String>(EP_CALENDAR, "events", index, "start", range); }
+String InkBridge::getCalendarEventTitle(int index, String range) { return itemField<String>(EP_CALENDAR, "events", index, "summary", range); }
+String InkBridge::getCalendarEventLocation(int index, String range) { return itemField<String>(EP_CALENDAR, "events", index, "location", range); }
 #endif
 
 #if INK_ENABLE_TRAVEL
 Response InkBridge::getTravel(String origin, String destination, String mode)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    if (origin != "")
-        doc["origin"] = origin;
-    if (destination != "")
-        doc["destination"] = destination;
-    doc["mode"] = mode;
-
-    String json;
-    serializeJson(doc, json);
-    travel = sendRequest("/travel", "POST", json);
-    return travel;
+    return call(EP_TRAVEL, origin, destination, mode);
 }
 
-String InkBridge::getTravelDuration(String origin, String destination, String mode) {
-    if (travel.data.isNull()) getTravel(origin, destination, mode);
-    return travel.data["duration_traffic_text"].as<String>();
-}
-String InkBridge::getTravelDistance(String origin, String destination, String mode) {
-    if (travel.data.isNull()) getTravel(origin, destination, mode);
-    return travel.data["distance_text"].as<String>();
-}
-String InkBridge::getTravelOrigin(String origin, String destination, String mode) {
-    if (travel.data.isNull()) getTravel(origin, destination, mode);
-    return travel.data["start_address"].as<String>();
-}
-String InkBridge::getTravelDestination(String origin, String destination, String mode) {
-    if (travel.data.isNull()) getTravel(origin, destination, mode);
-    return travel.data["end_address"].as<String>();
-}
-String InkBridge::getTravelMode(String origin, String destination, String mode) {
-    if (travel.data.isNull()) getTravel(origin, destination, mode);
-    return travel.data["mode"].as<String>();
-}
+String InkBridge::getTravelDuration(String origin, String destination, String mode) { return field<String>(EP_TRAVEL, "duration_traffic_text", origin, destination, mode); }
+String InkBridge::getTravelDistance(String origin, String destination, String mode) { return field<String>(EP_TRAVEL, "distance_text", origin, destination, mode); }
+String InkBridge::getTravelOrigin(String origin, String destination, String mode) { return field<String>(EP_TRAVEL, "start_address", origin, destination, mode); }
+String InkBridge::getTravelDestination(String origin, String destination, String mode) { return field<String>(EP_TRAVEL, "end_address", origin, destination, mode); }
+String InkBridge::getTravelMode(String origin, String destination, String mode) { return field<String>(EP_TRAVEL, "mode", origin, destination, mode); }
 #endif
 
 #if INK_ENABLE_CANVAS
 Response InkBridge::getCanvas(String type, String domain, String canvasApiKey)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
+    JsonDocument doc(&InkPool::shared());
+    identify(doc);
     if (domain != "") doc["domain"] = domain;
     if (canvasApiKey != "") doc["canvas_key"] = canvasApiKey;
     doc["type"] = type;
 
-    String json;
-    serializeJson(doc, json);
+    const InkEndpoint &endpoint = type == "grades" ? EP_CANVAS_GRADES : EP_CANVAS_TODOS;
+    Response fresh = sendRequest(endpoint.path, "POST", InkPayload(doc), endpoint.priority);
+    InkLock lock(_locks[INK_SOURCE_CANVAS]);
+    Response &cached = type == "grades" ? canvasGrades : canvasTodos;
+    if (keepsCache(fresh))
+    {
+        cached.status = fresh.status;
+        return cached;
+    }
     if (type == "grades")
     {
-        canvasGrades = sendRequest("/canvas", "POST", json);
+        canvasGrades = std::move(fresh);
+        _gradeIndex.build(canvasGrades.data.as<JsonArray>(), "course_name");
+        parseGrades();
         return canvasGrades;
     }
     else
     {
-        canvasTodos = sendRequest("/canvas", "POST", json);
+        canvasTodos = std::move(fresh);
+        _todoIndex.build(canvasTodos.data.as<JsonArray>(), "id");
+        _todoIndex.sortBy("due_at");
         return canvasTodos;
     }
 }
 
-Response InkBridge::getCanvasAssignment(int index, String domain, String canvasApiKey) {
-    if (canvasTodos.data.isNull()) getCanvas("todo", domain, canvasApiKey);
-    Response r; r.status = "OK"; r.data = canvasTodos.data[index];
-    return r;
-}
+Response InkBridge::streamCanvas(String type, String domain, String canvasApiKey, ItemCallback onItem)
+{
+    JsonDocument doc(&InkPool::shared());
+    identify(doc);
+    if (domain != "") doc["domain"] = domain;
+    if (canvasApiKey != "") doc["canvas_key"] = canvasApiKey;
+    doc["type"] = type;
 
-Response InkBridge::getCanvasAssignment(String id, String domain, String canvasApiKey) {
-    if (canvasTodos.data.isNull()) getCanvas("todo", domain, canvasApiKey);
-    Response r; r.status = "NOT_FOUND";
-    JsonArray arr = canvasTodos.data.as<JsonArray>();
-    for(JsonVariant v : arr) {
-        if(v["id"].as<String>() == id) {
-            r.data = v; r.status = "OK"; break;
-        }
+    const InkEndpoint &endpoint = type == "grades" ? EP_CANVAS_GRADES : EP_CANVAS_TODOS;
+    return streamList(endpoint.path, InkPayload(doc), nullptr, onItem, endpoint.priority);
+}
+
+Response InkBridge::getCanvasAssignment(int index, String domain, String canvasApiKey) { return indexRow(EP_CANVAS_TODOS, &InkBridge::_todoIndex, index, domain, canvasApiKey); }
+Response InkBridge::getCanvasAssignment(String id, String domain, String canvasApiKey) { return indexRow(EP_CANVAS_TODOS, &InkBridge::_todoIndex, id, domain, canvasApiKey); }
+String InkBridge::getCanvasAssignmentName(int index, String domain, String canvasApiKey) { return indexField<String>(EP_CANVAS_TODOS, &InkBridge::_todoIndex, index, "name", domain, canvasApiKey); }
+String InkBridge::getCanvasAssignmentName(String id, String domain, String canvasApiKey) { return indexField<String>(EP_CANVAS_TODOS, &InkBridge::_todoIndex, id, "name", domain, canvasApiKey); }
+String InkBridge::getCanvasAssignmentDueDate(int index, String domain, String canvasApiKey) { return indexField<String>(EP_CANVAS_TODOS, &InkBridge::_todoIndex, index, "due_at", domain, canvasApiKey); }
+String InkBridge::getCanvasAssignmentDueDate(String id, String domain, String canvasApiKey) { return indexField<String>(EP_CANVAS_TODOS, &InkBridge::_todoIndex, id, "due_at", domain, canvasApiKey); }
+String InkBridge::getCanvasAssignmentType(int index, String domain, String canvasApiKey) { return indexField<String>(EP_CANVAS_TODOS, &InkBridge::_todoIndex, index, "type", domain, canvasApiKey); }
+String InkBridge::getCanvasAssignmentType(String id, String domain, String canvasApiKey) { return indexField<String>(EP_CANVAS_TODOS, &InkBridge::_todoIndex, id, "type", domain, canvasApiKey); }
+
+Response InkBridge::getCanvasNextDue(int count, String domain, String canvasApiKey) {
+    ensure(EP_CANVAS_TODOS, domain, canvasApiKey);
+    InkLock lock(_locks[INK_SOURCE_CANVAS]);
+    Response r; r.status = "OK";
+    JsonArray out = r.data.to<JsonArray>();
+
+    // Canvas due dates are UTC ISO-8601, so they order correctly as strings.
+    int rank = 0;
+    time_t now = time(nullptr);
+    if (now > 100000) {
+        struct tm utc;
+        char stamp[21];
+        gmtime_r(&now, &utc);
+        strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+        rank = _todoIndex.lowerBound(stamp);
+    }
+    for (int i = 0; i < count && rank < _todoIndex.size(); i++, rank++) {
+        out.add(_todoIndex.ordered(rank));
     }
     return r;
 }
 
-String InkBridge::getCanvasAssignmentName(int index, String domain, String canvasApiKey) {
-    if (canvasTodos.data.isNull()) getCanvas("todo", domain, canvasApiKey);
-    return canvasTodos.data[index]["name"].as<String>();
-}
-String InkBridge::getCanvasAssignmentName(String id, String domain, String canvasApiKey) {
-    Response r = getCanvasAssignment(id, domain, canvasApiKey);
-    return r.data["name"].as<String>();
-}
-String InkBridge::getCanvasAssignmentDueDate(int index, String domain, String canvasApiKey) {
-    if (canvasTodos.data.isNull()) getCanvas("todo", domain, canvasApiKey);
-    return canvasTodos.data[index]["due_at"].as<String>();
-}
-String InkBridge::getCanvasAssignmentDueDate(String id, String domain, String canvasApiKey) {
-    Response r = getCanvasAssignment(id, domain, canvasApiKey);
-    return r.data["due_at"].as<String>();
-}
-String InkBridge::getCanvasAssignmentType(int index, String domain, String canvasApiKey) {
-    if (canvasTodos.data.isNull()) getCanvas("todo", domain, canvasApiKey);
-    return canvasTodos.data[index]["type"].as<String>();
-}
-String InkBridge::getCanvasAssignmentType(String id, String domain, String canvasApiKey) {
-    Response r = getCanvasAssignment(id, domain, canvasApiKey);
-    return r.data["type"].as<String>();
-}
+Response InkBridge::getCanvasGradeSet(int index, String domain, String canvasApiKey) { return indexRow(EP_CANVAS_GRADES, &InkBridge::_gradeIndex, index, domain, canvasApiKey); }
+Response InkBridge::getCanvasGradeSet(String course, String domain, String canvasApiKey) { return indexRow(EP_CANVAS_GRADES, &InkBridge::_gradeIndex, course, domain, canvasApiKey); }
+String InkBridge::getCanvasLetterGrade(int index, String domain, String canvasApiKey) { return indexField<String>(EP_CANVAS_GRADES, &InkBridge::_gradeIndex, index, "grade", domain, canvasApiKey); }
+String InkBridge::getCanvasLetterGrade(String course, String domain, String canvasApiKey) { return indexField<String>(EP_CANVAS_GRADES, &InkBridge::_gradeIndex, course, "grade", domain, canvasApiKey); }
+int InkBridge::getCanvasNumericGrade(int index, String domain, String canvasApiKey) { return indexField<int>(EP_CANVAS_GRADES, &InkBridge::_gradeIndex, index, "score", domain, canvasApiKey); }
+int InkBridge::getCanvasNumericGrade(String course, String domain, String canvasApiKey) { return indexField<int>(EP_CANVAS_GRADES, &InkBridge::_gradeIndex, course, "score", domain, canvasApiKey); }
 
-Response InkBridge::getCanvasGradeSet(int index, String domain, String canvasApiKey) {
-    if (canvasGrades.data.isNull()) getCanvas("grades", domain, canvasApiKey);
-    Response r; r.status = "OK"; r.data = canvasGrades.data[index];
-    return r;
+LetterGrade InkBridge::getCanvasGradeCode(int index, String domain, String canvasApiKey) {
+    ensure(EP_CANVAS_GRADES, domain, canvasApiKey);
+    InkLock lock(_locks[INK_SOURCE_CANVAS]);
+    if (index < 0 || index >= _gradeCodeCount) return GRADE_NONE;
+    return _gradeCodes[index];
 }
-Response InkBridge::getCanvasGradeSet(String course, String domain, String canvasApiKey) {
-    if (canvasGrades.data.isNull()) getCanvas("grades", domain, canvasApiKey);
-    Response r; r.status = "NOT_FOUND";
-    JsonArray arr = canvasGrades.data.as<JsonArray>();
-    for(JsonVariant v : arr) {
-        if(v["course_name"].as<String>() == course) {
-            r.data = v; r.status = "OK"; break;
-        }
+
+void InkBridge::parseGrades()
+{
+    delete[] _gradeCodes;
+    _gradeCodes = nullptr;
+    _gradeCodeCount = 0;
+    _gpaValid[0] = _gpaValid[1] = false;
+
+    int n = _gradeIndex.size();
+    if (n == 0)
+        return;
+    _gradeCodes = new LetterGrade[n];
+    if (!_gradeCodes)
+        return;
+    for (int i = 0; i < n; i++)
+        _gradeCodes[i] = GradeScale::parse(_gradeIndex.at(i)["grade"]);
+    _gradeCodeCount = n;
+}
+
+double InkBridge::computeGPA(const GradeScale &scale, bool weighted)
+{
+    double total = 0, credits = 0;
+    for (int i = 0; i < _gradeCodeCount; i++) {
+        if (_gradeCodes[i] == GRADE_NONE) continue;
+        const char *course = _gradeIndex.at(i)["course_name"];
+        double c = scale.credits(course);
+        double points = scale.points(_gradeCodes[i]);
+        if (weighted) points += scale.weightBonus(course);
+        total += points * c;
+        credits += c;
     }
-    return r;
-}
-String InkBridge::getCanvasLetterGrade(int index, String domain, String canvasApiKey) {
-    if (canvasGrades.data.isNull()) getCanvas("grades", domain, canvasApiKey);
-    return canvasGrades.data[index]["grade"].as<String>();
-}
-String InkBridge::getCanvasLetterGrade(String course, String domain, String canvasApiKey) {
-    Response r = getCanvasGradeSet(course, domain, canvasApiKey);
-    return r.data["grade"].as<String>();
+    if (credits <= 0) return 0.0;
+    return total / credits;
 }
-int InkBridge::getCanvasNumericGrade(int index, String domain, String canvasApiKey) {
-    if (canvasGrades.data.isNull()) getCanvas("grades", domain, canvasApiKey);
-    return canvasGrades.data[index]["score"].as<int>();
-}
-int InkBridge::getCanvasNumericGrade(String course, String domain, String canvasApiKey) {
-    Response r = getCanvasGradeSet(course, domain, canvasApiKey);
-    return r.data["score"].as<int>();
+
+double InkBridge::getGPAEstimate(bool weighted, String domain, String canvasApiKey) {
+    if (missing(INK_SOURCE_CANVAS, canvasGrades)) getCanvas("grades", domain, canvasApiKey);
+    InkLock lock(_locks[INK_SOURCE_CANVAS]);
+    if (_gpaRevision != gradeScale.revision()) {
+        _gpaValid[0] = _gpaValid[1] = false;
+        _gpaRevision = gradeScale.revision();
+    }
+    int slot = weighted ? 1 : 0;
+    if (!_gpaValid[slot]) {
+        _gpaCache[slot] = computeGPA(gradeScale, weighted);
+        _gpaValid[slot] = true;
+    }
+    return _gpaCache[slot];
 }
 
 double InkBridge::getGPAEstimate(bool weighted, String domain, String canvasApiKey, double Aplus, double A, double Aminus,
@@ -769,122 +3647,282 @@ double InkBridge::getGPAEstimate(bool weighted, String domain, String canvasApiK
                         double Cplus, double C, double Cminus,
                         double Dplus, double D, double Dminus,
                         double F) {
-    if (canvasGrades.data.isNull()) getCanvas("grades", domain, canvasApiKey);
-    double total = 0; int count = 0;
-    JsonArray arr = canvasGrades.data.as<JsonArray>();
-    for(JsonVariant v : arr) {
-        String g = v["grade"].as<String>();
-        if(g == "A+") total += Aplus; else if(g == "A") total += A; else if(g == "A-") total += Aminus;
-        else if(g == "B+") total += Bplus; else if(g == "B") total += B; else if(g == "B-") total += Bminus;
-        else if(g == "C+") total += Cplus; else if(g == "C") total += C; else if(g == "C-") total += Cminus;
-        else if(g == "D+") total += Dplus; else if(g == "D") total += D; else if(g == "D-") total += Dminus;
-        else total += F;
-        count++;
-    }
-    if(count == 0) return 0.0;
-    return total / count;
+    if (missing(INK_SOURCE_CANVAS, canvasGrades)) getCanvas("grades", domain, canvasApiKey);
+    InkLock lock(_locks[INK_SOURCE_CANVAS]);
+    GradeScale scale;
+    const double points[] = {Aplus, A, Aminus, Bplus, B, Bminus, Cplus, C, Cminus, Dplus, D, Dminus, F};
+    for (int g = GRADE_A_PLUS; g <= GRADE_F; g++) scale.setPoints((LetterGrade)g, points[g]);
+    return computeGPA(scale, weighted);
 }
 #endif
 
 #if INK_ENABLE_SPOTIFY
 Response InkBridge::spotifyRequest(String endpoint, String method, String body)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    doc["endpoint"] = endpoint;
-    doc["method"] = method;
-    if (body != "")
-        doc["body"] = body;
-
-    String json;
-    serializeJson(doc, json);
-    return sendRequest("/spotify/request", "POST", json);
+    return call(EP_SPOTIFY_REQUEST, endpoint, method, body);
 }
 
 Response InkBridge::getSpotifyAlbums(int limit, int offset)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    doc["limit"] = limit;
-    doc["offset"] = offset;
-
-    String json;
-    serializeJson(doc, json);
-    return sendRequest("/spotify/user_albums", "POST", json);
+    return call(EP_SPOTIFY_ALBUMS, limit, offset);
 }
 
 Response InkBridge::getSpotifyPlaylists(int limit, int offset)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    doc["limit"] = limit;
-    doc["offset"] = offset;
-
-    String json;
-    serializeJson(doc, json);
-    return sendRequest("/spotify/user_playlists", "POST", json);
+    return call(EP_SPOTIFY_PLAYLISTS, limit, offset);
 }
 
 Response InkBridge::getSpotifyLikedSongs(int limit, int offset)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    doc["limit"] = limit;
-    doc["offset"] = offset;
-
-    String json;
-    serializeJson(doc, json);
-    return sendRequest("/spotify/liked_songs", "POST", json);
+    return call(EP_SPOTIFY_LIKED, limit, offset);
 }
 
 Response InkBridge::getSpotifyFollowedArtists(int limit, String after)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    doc["limit"] = limit;
-    if (after != "")
-        doc["after"] = after;
+    return call(EP_SPOTIFY_ARTISTS, limit, after);
+}
 
-    String json;
-    serializeJson(doc, json);
-    return sendRequest("/spotify/followed_artists", "POST", json);
+// Spotify list replies keep their elements under "items"
+Response InkBridge::streamSpotifyAlbums(int limit, int offset, ItemCallback onItem)
+{
+    const InkValue values[] = {limit, offset};
+    return streamList(EP_SPOTIFY_ALBUMS.path, endpointPayload(EP_SPOTIFY_ALBUMS, values), "items", onItem, EP_SPOTIFY_ALBUMS.priority);
 }
 
-Response InkBridge::getSpotifyDevices()
+Response InkBridge::streamSpotifyPlaylists(int limit, int offset, ItemCallback onItem)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
+    const InkValue values[] = {limit, offset};
+    return streamList(EP_SPOTIFY_PLAYLISTS.path, endpointPayload(EP_SPOTIFY_PLAYLISTS, values), "items", onItem, EP_SPOTIFY_PLAYLISTS.priority);
+}
+
+Response InkBridge::streamSpotifyLikedSongs(int limit, int offset, ItemCallback onItem)
+{
+    const InkValue values[] = {limit, offset};
+    return streamList(EP_SPOTIFY_LIKED.path, endpointPayload(EP_SPOTIFY_LIKED, values), "items", onItem, EP_SPOTIFY_LIKED.priority);
+}
 
-    String json;
-    serializeJson(doc, json);
-    return sendRequest("/spotify/devices", "POST", json);
+Response InkBridge::getSpotifyDevices()
+{
+    return call(EP_SPOTIFY_DEVICES);
 }
 
 Response InkBridge::spotifyPlayback(String action, String uri, int volume, int position, String state, String targetDeviceId)
 {
-    JsonDocument doc;
-    doc["uid"] = _uid;
-    doc["device_id"] = _deviceId;
-    doc["action"] = action;
-    if (uri != "")
-        doc["uri"] = uri;
-    if (volume != -1)
-        doc["volume_percent"] = volume;
-    if (position != -1)
-        doc["position_ms"] = position;
-    if (state != "")
-        doc["state"] = state;
-    if (targetDeviceId != "")
-        doc["target_device_id"] = targetDeviceId;
-
-    String json;
-    serializeJson(doc, json);
-    return sendRequest("/spotify/playback", "POST", json);
+    InkCommandJournal::Command command = {};
+    strlcpy(command.action, action.c_str(), sizeof(command.action));
+    strlcpy(command.uri, uri.c_str(), sizeof(command.uri));
+    strlcpy(command.state, state.c_str(), sizeof(command.state));
+    strlcpy(command.device, targetDeviceId.c_str(), sizeof(command.device));
+    command.volume = volume;
+    command.position = position;
+    time_t now = time(nullptr);
+    command.queuedAt = now > 100000 ? (uint32_t)now : 0;
+
+    // Anything that does not fit the journal is sent as is, never queued
+    bool journal = _journalEnabled && action.length() < sizeof(command.action) && uri.length() < sizeof(command.uri) &&
+                   state.length() < sizeof(command.state) && targetDeviceId.length() < sizeof(command.device);
+    if (journal)
+    {
+        // Stay behind commands that are still waiting
+        InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+        if (_journal.size() > 0 || _replaying)
+            return queuePlayback(command);
+    }
+
+    Response response = sendPlayback(command);
+    if (journal && notSent(response))
+    {
+        InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+        return queuePlayback(command);
+    }
+    if (response.status == "OK")
+    {
+        InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+        _nowPlaying.apply(command.action, command.position, millis());
+    }
+    return response;
+}
+
+Response InkBridge::sendPlayback(const InkCommandJournal::Command &command)
+{
+    JsonDocument doc(&InkPool::shared());
+    identify(doc);
+    doc["action"] = command.action;
+    if (command.uri[0])
+        doc["uri"] = command.uri;
+    if (command.volume != -1)
+        doc["volume_percent"] = command.volume;
+    if (command.position != -1)
+        doc["position_ms"] = command.position;
+    if (command.state[0])
+        doc["state"] = command.state;
+    if (command.device[0])
+        doc["target_device_id"] = command.device;
+
+    return sendRequest("/spotify/playback", "POST", InkPayload(doc), INK_PRIORITY_INTERACTIVE);
+}
+
+// Caller holds the Spotify lock
+Response InkBridge::queuePlayback(const InkCommandJournal::Command &command)
+{
+    _journal.push(command);
+    _journal.save(storage());
+    Serial.printf("[Ink] Playback '%s' queued (%d pending)\n", command.action, _journal.size());
+
+    Response response;
+    response.status = "QUEUED";
+    response.data["pending"] = _journal.size();
+    startReplay();
+    return response;
+}
+
+// Failures where the request never reached the server, so replaying is safe
+bool InkBridge::notSent(const Response &response)
+{
+    return response.status == "WIFI_DISCONNECTED" || response.status == "CONNECT_FAILED" ||
+           response.status == "HOST_UNAVAILABLE" || response.status == "RATE_LIMITED" ||
+           response.status == "HTTP_ERROR_-1"; // connection refused
+}
+
+void InkBridge::setSpotifyJournal(bool enabled)
+{
+    InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+    _journalEnabled = enabled;
+}
+
+int InkBridge::pendingSpotifyCommands()
+{
+    InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+    return _journal.size();
+}
+
+// Replays in a task so a WiFi event or a queued call never blocks on the network
+void InkBridge::startReplay()
+{
+    InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+    if (_replayTask || _replaying || _journal.size() == 0 || WiFi.status() != WL_CONNECTED)
+        return;
+    if (xTaskCreatePinnedToCore(replayTask, "ink_replay", 6144, this, 1, &_replayTask, 0) != pdPASS)
+    {
+        _replayTask = nullptr;
+        Serial.println("[Ink] Replay task creation failed");
+    }
+}
+
+void InkBridge::replayTask(void *arg)
+{
+    InkBridge *self = (InkBridge *)arg;
+    self->replaySpotifyCommands();
+    {
+        InkLock lock(self->_locks[INK_SOURCE_SPOTIFY]);
+        self->_replayTask = nullptr;
+    }
+    vTaskDelete(nullptr);
+}
+
+// Sends the journal front to back in one burst, waiting out the rate limit. A
+// command that still cannot go out is put back and the rest waits for the next
+// connection. Rejected commands are dropped, as are ones older than
+// INK_JOURNAL_MAX_AGE_S.
+int InkBridge::replaySpotifyCommands()
+{
+    {
+        InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+        if (_replaying)
+            return 0;
+        _replaying = true;
+    }
+
+    int sent = 0;
+    time_t now = time(nullptr);
+    InkCommandJournal::Command command;
+    for (;;)
+    {
+        {
+            InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+            if (!_journal.popFront(command))
+                break;
+        }
+        if (now > 100000 && command.queuedAt != 0 && (uint32_t)now - command.queuedAt > INK_JOURNAL_MAX_AGE_S)
+        {
+            Serial.printf("[Ink] Queued playback '%s' expired\n", command.action);
+            continue;
+        }
+
+        Response response = sendPlayback(command);
+        if (response.status == "RATE_LIMITED" && WiFi.status() == WL_CONNECTED)
+        {
+            // Wait for the next token; new input keeps folding into the journal meanwhile
+            {
+                InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+                _journal.pushFront(command);
+            }
+            delay(1000);
+            continue;
+        }
+        InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+        if (notSent(response))
+        {
+            _journal.pushFront(command);
+            break;
+        }
+        if (response.status == "OK")
+        {
+            sent++;
+            _nowPlaying.apply(command.action, command.position, millis());
+        }
+        else
+            Serial.printf("[Ink] Queued playback '%s' rejected: %s\n", command.action, response.status.c_str());
+        _journal.save(storage()); // a reboot mid-burst must not send it twice
+    }
+
+    InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+    _journal.save(storage());
+    _replaying = false;
+    if (sent > 0)
+        Serial.printf("[Ink] Replayed %d queued playback commands\n", sent);
+    return sent;
+}
+
+void InkBridge::setNowPlayingDrift(uint32_t driftMs)
+{
+    InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+    _nowPlayingDriftMs = driftMs;
+}
+
+InkTrackState InkBridge::getNowPlaying()
+{
+    bool due;
+    {
+        InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+        due = _nowPlaying.needsSync(millis(), _nowPlayingDriftMs);
+        if (due)
+            _nowPlaying.attempted(millis()); // other tasks keep interpolating meanwhile
+    }
+    if (due)
+        syncNowPlaying();
+    InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+    return _nowPlaying.state(millis());
+}
+
+// A failed read keeps the old estimate; the next try waits INK_NOW_PLAYING_MIN_MS.
+void InkBridge::syncNowPlaying()
+{
+    Response reply = spotifyRequest("/me/player/currently-playing");
+    if (reply.status != "OK")
+    {
+        Serial.println("[Ink] Now playing sync failed: " + reply.status);
+        return;
+    }
+
+    // Nothing playing comes back without an item
+    JsonVariantConst item = reply.data["item"];
+    JsonVariantConst artist = item["artists"][0]["name"];
+    if (artist.isNull())
+        artist = item["show"]["name"]; // podcast episode
+    InkLock lock(_locks[INK_SOURCE_SPOTIFY]);
+    _nowPlaying.sync(!item.isNull() && reply.data["is_playing"].as<bool>(), reply.data["progress_ms"].as<uint32_t>(),
+                     item["duration_ms"].as<uint32_t>(), item["name"].as<const char *>(), artist.as<const char *>(),
+                     item["uri"].as<const char *>(), millis());
 }
 #endif
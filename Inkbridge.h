@@ -3,29 +3,341 @@
 
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
 #include <NVSManager.h>
+#include <functional>
+#include "InkIndex.h"
+#include "GradeScale.h"
+#include "InkTimeSeries.h"
+#include "InkLock.h"
+#include "InkRingBuffer.h"
+#include "InkAstronomy.h"
+#include "InkHistoryStore.h"
+#include "InkHostPool.h"
+#include "InkCommandJournal.h"
+#include "InkPool.h"
+#include "InkHeapMonitor.h"
+#include "InkNowPlaying.h"
 
+#ifndef INK_ENABLE_WEATHER
 #define INK_ENABLE_WEATHER 1
+#endif
+#ifndef INK_ENABLE_STOCKS
 #define INK_ENABLE_STOCKS 1
+#endif
+#ifndef INK_ENABLE_CRYPTO
 #define INK_ENABLE_CRYPTO 1
+#endif
+#ifndef INK_ENABLE_NEWS
 #define INK_ENABLE_NEWS 1
+#endif
+#ifndef INK_ENABLE_CALENDAR
 #define INK_ENABLE_CALENDAR 1
+#endif
+#ifndef INK_ENABLE_TRAVEL
 #define INK_ENABLE_TRAVEL 1
+#endif
+#ifndef INK_ENABLE_CANVAS
 #define INK_ENABLE_CANVAS 1
+#endif
+#ifndef INK_ENABLE_SPOTIFY
 #define INK_ENABLE_SPOTIFY 1
+#endif
 
+#ifndef INK_MAX_FORECAST_DAYS
+#define INK_MAX_FORECAST_DAYS 7
+#endif
+#ifndef INK_MAX_HISTORY_DAYS
+#define INK_MAX_HISTORY_DAYS 7
+#endif
+#ifndef INK_HISTORY_PROBES
+#define INK_HISTORY_PROBES 4 // recent history dates the store does not hold (today, dates the server lacks)
+#endif
+#ifndef INK_HISTORY_RETRY_MS
+#define INK_HISTORY_RETRY_MS 900000 // such a date is answered from the last request for this long
+#endif
+#ifndef INK_MAX_SITES
+#define INK_MAX_SITES 4 // geocoded locations kept for on-device astronomy
+#endif
+#ifndef INK_MAX_CHANGES
+#define INK_MAX_CHANGES 16 // changed items reported per delta sync
+#endif
+#ifndef INK_MAX_SERIES
+#define INK_MAX_SERIES 4 // symbols tracked per market (stocks, crypto)
+#endif
+#ifndef INK_DNS_TTL_MS
+#define INK_DNS_TTL_MS 300000 // how long a resolved API address is reused
+#endif
+#ifndef INK_PREWARM_IDLE_MS
+#define INK_PREWARM_IDLE_MS 30000 // pre-warmed connections older than this are not used
+#endif
+#ifndef INK_MAX_ACTIVE_REQUESTS
+#define INK_MAX_ACTIVE_REQUESTS 1 // concurrent normal/background requests; interactive ones come on top
+#endif
+#ifndef INK_STEADY_CONNECTIONS
+#define INK_STEADY_CONNECTIONS (INK_MAX_ACTIVE_REQUESTS + 2) // client objects reserved in steady-state mode: gated, interactive, pre-warm/pipeline
+#endif
+#ifndef INK_REQUEST_BYTES
+#define INK_REQUEST_BYTES 512 // request bodies up to this size are built on the caller's stack, see InkPayload
+#endif
+#ifndef INK_URL_BYTES
+#define INK_URL_BYTES 256 // request URL buffer, on the stack
+#endif
+#ifndef INK_IMAGE_CHUNK
+#define INK_IMAGE_CHUNK 512 // bytes per streamImage() sink call, on the caller's stack
+#endif
+#ifndef INK_IMAGE_RESUMES
+#define INK_IMAGE_RESUMES 2 // ranged re-requests after an image download breaks off
+#endif
+#ifndef INK_MAX_DEADLINES
+#define INK_MAX_DEADLINES 4 // tasks with an InkDeadline scope open at the same time
+#endif
+#ifndef INK_MAX_RATE_LIMITS
+#define INK_MAX_RATE_LIMITS 16 // endpoints with their own token bucket
+#endif
+#ifndef INK_RATE_PER_MINUTE
+#define INK_RATE_PER_MINUTE 30 // default request budget per endpoint
+#endif
+#ifndef INK_RATE_BURST
+#define INK_RATE_BURST 5
+#endif
+#ifndef INK_RETRY_AFTER_DEFAULT_S
+#define INK_RETRY_AFTER_DEFAULT_S 60 // back-off after a 429 without a usable Retry-After
+#endif
+#ifndef INK_REGISTER_JITTER_MS
+#define INK_REGISTER_JITTER_MS 0 // random delay before auto-registration, see setJitter
+#endif
+#ifndef INK_POLL_JITTER_PERCENT
+#define INK_POLL_JITTER_PERCENT 10 // spread applied by pollInterval()
+#endif
+#ifndef INK_PIPELINE_DEPTH
+#define INK_PIPELINE_DEPTH 4 // pending jobs and undelivered results in pipelined mode
+#endif
+
+// Documents draw from InkPool::shared(), the steady-state arena once reserved
 struct Response {
+  Response() : data(&InkPool::shared()) {}
   String status;
   JsonDocument data;
 };
 
+// Each cached data source has its own lock; see InkBridge::lockSource
+enum InkSource : uint8_t {
+  INK_SOURCE_CONFIG, // device id, API key, UID, API URL
+  INK_SOURCE_WEATHER,
+  INK_SOURCE_FORECAST,
+  INK_SOURCE_HISTORY,
+  INK_SOURCE_ASTRONOMY,
+  INK_SOURCE_STOCKS,
+  INK_SOURCE_CRYPTO,
+  INK_SOURCE_NEWS,
+  INK_SOURCE_CALENDAR,
+  INK_SOURCE_TRAVEL,
+  INK_SOURCE_CANVAS,
+  INK_SOURCE_SPOTIFY, // playback command journal
+  INK_SOURCE_COUNT
+};
+
+// Request classes. Interactive requests (Spotify controls) skip the request
+// queue and run on their own connection; queued normal requests go before
+// background refreshes (news, calendar, history, Canvas).
+enum InkPriority : uint8_t {
+  INK_PRIORITY_INTERACTIVE,
+  INK_PRIORITY_NORMAL,
+  INK_PRIORITY_BACKGROUND,
+  INK_PRIORITY_COUNT
+};
+
+// Compile-time description of a request: path, body parameters and, for a
+// cached source, the Response it fills. The simple endpoints and the field,
+// list and index accessors of every cached source are generated from a table of
+// these (top of the endpoint section in Inkbridge.cpp) by a few generic
+// builders instead of a hand-written method each.
+enum InkParamKind : uint8_t {
+  INK_PARAM_TEXT,     // always sent
+  INK_PARAM_OPTIONAL, // left out when empty
+  INK_PARAM_NUMBER
+};
+
+struct InkParam {
+  const char *name;
+  InkParamKind kind;
+};
+
+class InkBridge;
+struct InkValue;
+struct InkEndpoint {
+  const char *path;
+  InkPriority priority;
+  InkSource source;           // lock of the cache
+  Response InkBridge::*cache; // nullptr for uncached endpoints
+  uint8_t paramCount;
+  InkParam params[3];
+  // Fills the cache when the reply is committed specially (delta sync,
+  // indexes); nullptr stores it as is
+  Response (*fetch)(InkBridge &bridge, const InkValue *values);
+};
+
+// A serialized request body. Bodies up to INK_REQUEST_BYTES are written into
+// the object itself, which lives on the calling task's stack, so building and
+// sending a request allocates nothing; longer ones fall back to a String.
+class InkPayload {
+public:
+  InkPayload(const char *text = "");
+  InkPayload(const String &text);
+  explicit InkPayload(const JsonDocument &doc);
+
+  const uint8_t *data() const;
+  size_t length() const;
+  String str() const; // a copy, for the fixture hook and queued jobs
+
+private:
+  void assign(const char *text, size_t length);
+
+  char _inline[INK_REQUEST_BYTES];
+  size_t _length; // of _inline; the body is in _text when _inline is unused
+  bool _inlined;
+  String _text;
+};
+
+// One argument for an InkEndpoint parameter
+struct InkValue {
+  InkValue(const String &value) : text(&value), number(0) {}
+  InkValue(int value) : text(nullptr), number(value) {}
+  const String *text;
+  long number;
+};
+
+// micros() timestamps of one request, see InkBridge::getLatencyStats
+struct InkTiming {
+  uint32_t queuedUs;    // submitted, or sendRequest() entered
+  uint32_t sentUs;      // connected, request about to be sent
+  uint32_t firstByteUs; // response headers received
+  uint32_t receivedUs;  // last body byte received
+  uint32_t parsedUs;    // JsonDocument complete
+};
+
+// Layout of a streamed image, from the relay's response headers
+struct InkImageInfo {
+  uint16_t width;
+  uint16_t height;
+  uint8_t depth;  // bits per pixel: 1, 2 or 4, rows packed MSB first
+  uint32_t total; // bytes in the whole image, 0 if the server did not say
+};
+
+// A finished pipelined request, see InkBridge::nextResult
+struct InkResult {
+  uint32_t tag;
+  InkSource source; // INK_SOURCE_COUNT for submitRequest() jobs
+  Response response;
+  InkTiming timing;
+};
+
+// Averages over all requests so far. Latency runs from sending the request to
+// the finished JsonDocument, so queueing time is not included.
+struct InkLatencyStats {
+  uint32_t sequentialCount;
+  uint32_t sequentialAvgUs;
+  uint32_t sequentialParseAvgUs; // time spent parsing after the last byte
+  uint32_t pipelinedCount;
+  uint32_t pipelinedAvgUs;
+  uint32_t pipelinedParseAvgUs;  // parse time left after the last byte
+  uint64_t bytesSent;            // request bodies
+  uint64_t bytesReceived;        // response bodies
+
+  // Press-to-request: from the call or submit until the request is sent,
+  // including queueing and connect, per InkPriority
+  uint32_t waitCount[INK_PRIORITY_COUNT];
+  uint32_t waitAvgUs[INK_PRIORITY_COUNT];
+  uint32_t waitMaxUs[INK_PRIORITY_COUNT];
+};
+
+#if INK_ENABLE_NEWS || INK_ENABLE_CALENDAR
+enum ChangeKind : uint8_t {
+  CHANGE_ADDED,
+  CHANGE_UPDATED,
+  CHANGE_REMOVED
+};
+
+struct ChangedItem {
+  char id[48]; // display copy, truncated
+  ChangeKind kind;
+  int index; // position in the local list after the sync, -1 when removed
+};
+
+// Items touched by the last delta sync, so the display can refresh only those rows.
+// When full is set the whole list was replaced (or too many items changed) and
+// everything should be redrawn. A removal moves every later row up, so rows from
+// shiftedFrom to the end of the old list must be redrawn as well.
+struct ChangeSet {
+  bool full;
+  uint8_t count;
+  int shiftedFrom; // first row moved by a removal, -1 when nothing was removed
+  ChangedItem items[INK_MAX_CHANGES];
+};
+#endif
+
+#if INK_ENABLE_WEATHER
+// Fixed-layout results, decoded once per fetch in decode-once mode (see
+// InkBridge::setDecodeOnce) or on first struct access otherwise. Text fields are truncated to fit.
+struct WeatherNow {
+  bool valid;
+  float temperature;
+  char condition[32];
+  char description[64];
+  char location[48];
+};
+
+struct ForecastDay {
+  char date[11]; // YYYY-MM-DD
+  float minTemp;
+  float maxTemp;
+  char condition[32];
+};
+
+struct WeatherForecast {
+  bool valid;
+  uint8_t count;
+  char location[48];
+  char trend[32];
+  ForecastDay days[INK_MAX_FORECAST_DAYS];
+};
+
+struct HistoryDay {
+  char date[11]; // YYYY-MM-DD
+  float avgTemp;
+  char condition[32];
+};
+
+struct WeatherHistory {
+  bool valid;
+  uint8_t count;
+  char location[48];
+  char trend[32];
+  HistoryDay days[INK_MAX_HISTORY_DAYS];
+};
+
+struct Astronomy {
+  bool valid;
+  char sunrise[9]; // hh:mm AM
+  char sunset[9];
+  char moonrise[9];
+  char moonset[9];
+  char location[48];
+  char moonPhase[20];
+  int moonIllumination;
+  bool isDaytime;
+};
+#endif
+
 class InkBridge
 {
 public:
   InkBridge();
   InkBridge(bool resetDevice = false);
   InkBridge(const char *apiUrl);
+  ~InkBridge();
 
   bool begin();
   bool isRegistered();
@@ -39,6 +351,118 @@ public:
   String getApiUrl();
   String getUID();
 
+  // Failover hosts. Each request goes to the healthy base URL with the lowest
+  // expected latency; a host that keeps failing is skipped for a while (circuit
+  // breaker). The extra hosts are kept in NVS.
+  bool addApiHost(String url);
+  void clearApiHosts();   // back to the primary URL only
+  Response getApiHosts(); // url, latency_ms, error_rate, state for each host
+
+  // All accessors are safe to call from several tasks: requests run without any
+  // lock held and the finished result is swapped in under the source's lock.
+  // Hold this lock when reading the public Response members directly.
+  InkLock lockSource(InkSource source);
+
+  // When enabled, weather replies are decoded into the fixed-layout structs below
+  // and their JsonDocuments are freed right after the fetch.
+  void setDecodeOnce(bool enabled);
+
+  // When enabled, getCalendar() and getNews() send the last sync token and apply
+  // only the additions, updates and deletions the server returns.
+  void setDeltaSync(bool enabled);
+
+  // Resolves the API host and opens its TLS connection in the background so the
+  // next request starts on an established socket. begin() calls this and hooks
+  // it to the WiFi got-IP event unless disabled with setPrewarm(false) first.
+  bool prewarm();
+  void setPrewarm(bool enabled);
+
+  // Fleet settings. setStorageNamespace() gives this instance its own NVS
+  // namespace (max 15 chars) and setDeviceMac() replaces the WiFi MAC when a new
+  // device id is created, so several instances can act as separate devices.
+  // setJitter() delays auto-registration by a random 0..registerMs and sets the
+  // spread pollInterval() applies to a polling period, so a fleet that powers up
+  // together does not hit the server in lockstep.
+  void setStorageNamespace(String ns);
+  void setDeviceMac(String mac);
+  void setJitter(uint32_t registerMs, uint8_t pollPercent);
+  uint32_t pollInterval(uint32_t intervalMs); // intervalMs +/- pollPercent, random per call
+
+  // Answers blocking requests from recorded fixtures instead of the network, for
+  // benchmarks and offline development. The hook gets the endpoint and the JSON
+  // payload that would have been sent; returning false sends the request as usual.
+  typedef std::function<bool(const String &endpoint, const String &payload, Response &response)> FixtureHook;
+  void setFixtureHook(FixtureHook hook);
+
+  // Streaming list calls parse the response one element at a time into a small
+  // reused document and pass it to the callback, so memory stays flat however
+  // long the list is and the first rows can be drawn while the rest is still
+  // arriving. Return false from the callback to stop early. The cache is not
+  // touched; the returned Response carries the status and data["count"].
+  typedef std::function<bool(JsonObjectConst item, int index)> ItemCallback;
+
+  // Streams a packed bitmap from the relay into sink in INK_IMAGE_CHUNK byte
+  // pieces (the last one may be shorter), with no buffer for the whole image.
+  // offset is the byte position of data in the image, so the sink can map it to
+  // a framebuffer window. resource names what to render, e.g.
+  // "spotify/now_playing" for album art or a panel id; width and height of 0
+  // leave the size to the server. If the connection breaks, the download is
+  // resumed with a Range request up to INK_IMAGE_RESUMES times. After that the
+  // status is "INCOMPLETE" and data["offset"] is where to continue by passing
+  // it back in. Returning false from the sink stops early with status "OK".
+  // data also carries width, height, depth and total.
+  typedef std::function<bool(const uint8_t *data, size_t length, uint32_t offset, const InkImageInfo &info)> ImageSink;
+  Response streamImage(String resource, uint16_t width, uint16_t height, uint8_t depth, ImageSink sink, uint32_t offset = 0);
+
+  // Token bucket per endpoint path, e.g. "/stock" or "/spotify/playback". An empty
+  // endpoint sets the default for endpoints without their own limit. Requests
+  // over budget, or within a server Retry-After window, are not sent: the cached
+  // value comes back with status "RATE_LIMITED".
+  void setRateLimit(String endpoint, float perMinute, uint8_t burst);
+
+  // Pipelined mode: a task on core 0 does the HTTP transfer and streams the body
+  // through a lock-free ring of ringSize bytes to a parser task on core 1, so
+  // parsing overlaps the download. Submitted jobs return immediately; collect the
+  // results with nextResult(). News and calendar results also update the cache.
+  bool beginPipeline(size_t ringSize = 4096);
+  void endPipeline();
+  bool submitRequest(String endpoint, String payload, uint32_t tag = 0, InkPriority priority = INK_PRIORITY_NORMAL);
+#if INK_ENABLE_NEWS
+  bool submitNews(String category, uint32_t tag = 0);
+#endif
+#if INK_ENABLE_CALENDAR
+  bool submitCalendar(String range, uint32_t tag = 0);
+#endif
+  bool nextResult(InkResult &result, uint32_t waitMs = 0);
+  InkLatencyStats getLatencyStats();
+
+  // Deadline budgets. setDeadline() gives every blocking call at most ms (0, the
+  // default, for no limit) across queueing, connect, TLS handshake, send,
+  // receive and retries: the timeouts of each step are cut to what is left.
+  // An InkDeadline scope shares one budget between all calls its task makes
+  // inside it, e.g. one frame. A call that runs out returns the cached value
+  // with status "DEADLINE_EXCEEDED", like "RATE_LIMITED".
+  void setDeadline(uint32_t ms);
+  uint32_t beginDeadline(uint32_t ms); // used by InkDeadline
+  void endDeadline(uint32_t previous);
+
+  // Steady-state mode, for devices that run for weeks: begin() reserves the
+  // JsonDocument arena (INK_POOL_BYTES, see InkPool) and INK_STEADY_CONNECTIONS
+  // client objects, and requests reuse them instead of allocating their own;
+  // replies are parsed straight off the socket rather than through a String
+  // copy of the body. Call before begin().
+  void setSteadyState(bool enabled);
+  InkPoolStats getPoolStats();
+
+  // Heap monitor: free heap, largest free block and fragmentation, sampled
+  // every INK_HEAP_SAMPLE_MS after a request (see InkHeapMonitor for how a long
+  // run is kept in INK_HEAP_SAMPLES entries). sampleHeap() records one now.
+  // getHeapHistory() copies up to max samples, oldest first, and returns the
+  // count; baseline and lowest, when given, get the first sample and the one
+  // with the smallest largest block.
+  InkHeapSample sampleHeap();
+  int getHeapHistory(InkHeapSample *out, int max, InkHeapSample *baseline = nullptr, InkHeapSample *lowest = nullptr);
+
 #if INK_ENABLE_WEATHER
   Response getWeather(String location = "");
   double getWeatherTemperature(String location = "");
@@ -68,6 +492,12 @@ public:
   String getWeatherHistoryCondition(int index, String location = "", String date = "");
   String getWeatherHistoryTrend(String location = "", String date = "");
 
+  // Every fetched history day is merged into a per-location store kept in NVS.
+  // The date-based helpers above read it first and only request dates it lacks;
+  // this fills [from, to] (YYYY-MM-DD) the same way and returns how many of
+  // those days are now stored.
+  int fetchWeatherHistoryRange(String from, String to, String location = "");
+
   Response getAstronomy(String location = ""); 
   String getAstronomySunrise(String location = "");
   String getAstronomySunset(String location = "");
@@ -78,10 +508,26 @@ public:
   int getAstronomyMoonIllumination(String location = "");
   bool getAstronomyIsDaytime(String location = "");
 
+  WeatherNow getWeatherNow(String location = "");
+  WeatherForecast getWeatherForecastDays(String location = "", int days = 3);
+  WeatherHistory getWeatherHistoryDays(String location = "", String date = "");
+  Astronomy getAstronomyInfo(String location = "");
+
+  // Once a location's coordinates are known, getAstronomy() computes the reply on
+  // the device from the NTP clock. The first server reply that carries lat/lon
+  // teaches them; setAstronomyCoordinates() skips that round trip entirely.
+  void setAstronomyCoordinates(double lat, double lon, String location = "", String name = "");
+  void setLocalAstronomy(bool enabled);
+
   Response weatherHistory;
   Response weatherForecast;
   Response weather;
   Response astronomy;
+
+  WeatherNow decodedWeather = {};
+  WeatherForecast decodedForecast = {};
+  WeatherHistory decodedHistory = {};
+  Astronomy decodedAstronomy = {};
 #endif
 
 #if INK_ENABLE_STOCKS
@@ -93,6 +539,9 @@ public:
   double getStockLow(String symbol = "");
 
   Response getStockArray(String symbol = "", int days = 7);
+  // Cached price history; after the first load only points newer than the last sample are requested.
+  // The series is updated in place: hold lockSource(INK_SOURCE_STOCKS) while reading it from another task.
+  InkTimeSeries *getStockSeries(String symbol, int days = 30);
   Response stocks;
 #endif
 
@@ -104,6 +553,7 @@ public:
   String getCryptoName(String symbol = "");
 
   Response getCryptoArray(String symbol, int days);
+  InkTimeSeries *getCryptoSeries(String symbol, int days = 30);
   Response crypto;
 #endif
 
@@ -112,6 +562,8 @@ public:
   int getNewsArticleCount(String category = "general");
   String getNewsArticleTitle(int index, String category = "general");
   String getNewsArticleSource(int index, String category = "general");
+  ChangeSet getNewsChanges();
+  Response streamNews(String category, ItemCallback onArticle);
 
   Response news;
 #endif
@@ -122,6 +574,8 @@ public:
   String getCalendarEventTime(int index, String range = "1d");
   String getCalendarEventTitle(int index, String range = "1d");
   String getCalendarEventLocation(int index, String range = "1d");
+  ChangeSet getCalendarChanges();
+  Response streamCalendar(String range, ItemCallback onEvent);
   Response calendar;
 #endif
 
@@ -151,12 +605,20 @@ public:
   String getCanvasLetterGrade(int index, String domain = "", String canvasApiKey = "");
   int getCanvasNumericGrade(String course, String domain = "", String canvasApiKey = "");
   int getCanvasNumericGrade(int index, String domain = "", String canvasApiKey = "");
-  double getGPAEstimate(bool weighted = false, String domain = "", String canvasApiKey = "", double Aplus = 4.0, double A = 4.0, double Aminus = 3.7,
+  Response getCanvasNextDue(int count = 5, String domain = "", String canvasApiKey = ""); // earliest not-yet-due assignments
+  LetterGrade getCanvasGradeCode(int index, String domain = "", String canvasApiKey = "");
+  // Credit-weighted GPA on gradeScale; weighted adds each course's bonus. Cached until grades or scale change.
+  double getGPAEstimate(bool weighted = false, String domain = "", String canvasApiKey = "");
+  // Deprecated: per-call scale, not cached. Use gradeScale.setPoints() instead.
+  double getGPAEstimate(bool weighted, String domain, String canvasApiKey, double Aplus, double A = 4.0, double Aminus = 3.7,
                         double Bplus = 3.3, double B = 3.0, double Bminus = 2.7,
                         double Cplus = 2.3, double C = 2.0, double Cminus = 1.7,
                         double Dplus = 1.3, double D = 1.0, double Dminus = 0.7,
                         double F = 0.0);
 
+  Response streamCanvas(String type, String domain, String canvasApiKey, ItemCallback onItem);
+
+  GradeScale gradeScale;
   Response canvasGrades;
   Response canvasTodos;
 #endif
@@ -169,6 +631,25 @@ public:
   Response getSpotifyFollowedArtists(int limit = 5, String after = "");
   Response getSpotifyDevices();
   Response spotifyPlayback(String action, String uri = "", int volume = -1, int position = -1, String state = "", String targetDeviceId = "");
+  Response streamSpotifyAlbums(int limit, int offset, ItemCallback onItem);
+  Response streamSpotifyPlaylists(int limit, int offset, ItemCallback onItem);
+  Response streamSpotifyLikedSongs(int limit, int offset, ItemCallback onItem);
+
+  // spotifyPlayback() calls that cannot go out (WiFi down, no reachable host)
+  // return "QUEUED" and wait in a journal kept in NVS. Redundant commands are
+  // folded together; the rest is replayed in order once WiFi is back.
+  void setSpotifyJournal(bool enabled);
+  int pendingSpotifyCommands();
+  int replaySpotifyCommands(); // sends the journal now; returns how many went out
+
+  // Now playing, interpolated on the device: one read of
+  // /me/player/currently-playing gives the track, progress and play state, and
+  // the position then advances with millis(). getNowPlaying() only asks the
+  // server again at the end of the track, shortly after a spotifyPlayback()
+  // command, or once driftMs has passed, so a progress bar can be redrawn
+  // every second without a request each time.
+  InkTrackState getNowPlaying();
+  void setNowPlayingDrift(uint32_t driftMs);
 #endif
 
 private:
@@ -178,10 +659,265 @@ private:
   String _apiKey;
   String _friendlyName;
   bool _resetDevice;
+  bool _decodeOnce;
+  String _nvsNamespace;
+  String _deviceMac;
+  uint32_t _registerJitterMs;
+  uint8_t _pollJitterPercent;
+  const char *storage(); // NVS namespace, nullptr for the default one
+  FixtureHook _fixtureHook;
+  SemaphoreHandle_t _locks[INK_SOURCE_COUNT];
 
   // Internal helper to perform HTTP GET
-  Response sendRequest(String endpoint, String method, String payload);
+  Response sendRequest(String endpoint, String method, const InkPayload &payload, InkPriority priority = INK_PRIORITY_NORMAL);
   Response getRequest(String endpoint, bool includeApiKey);
+  bool wifiReady();
+  // host is updated on failover; failed has a bit per host this call already
+  // counted a failure against, so one call opens no breaker on its own
+  bool openRequest(HTTPClient &http, WiFiClientSecure &client, const String &endpoint, const String &method, int &host,
+                   uint32_t &failed, uint32_t rangeFrom = 0, uint32_t deadline = 0);
+  int performRequest(HTTPClient &http, WiFiClientSecure &client, const String &endpoint, const String &method,
+                     const InkPayload &payload, int &host, uint32_t &failed, uint32_t rangeFrom = 0, uint32_t deadline = 0);
+
+  // Deadlines are millis() values, 0 for none; guarded by the INK_SOURCE_CONFIG lock
+  struct DeadlineScope {
+    TaskHandle_t task;
+    uint32_t until;
+  };
+  uint32_t _deadlineMs;
+  DeadlineScope _deadlines[INK_MAX_DEADLINES];
+  uint32_t deadlineFor(); // for a call starting now on this task
+  static int32_t remainingMs(uint32_t deadline); // INT32_MAX without a deadline
+  static bool expired(uint32_t deadline);
+  static String requestStatus(int httpCode, DeserializationError error);
+  Response streamList(const String &endpoint, const InkPayload &payload, const char *listKey, ItemCallback onItem, InkPriority priority);
+
+  // Table-driven requests, see InkEndpoint
+  InkPayload endpointPayload(const InkEndpoint &endpoint, const InkValue *values);
+  Response callEndpoint(const InkEndpoint &endpoint, const InkValue *values);
+  template <typename... Args> Response call(const InkEndpoint &endpoint, const Args &...args);
+  template <typename... Args> void ensure(const InkEndpoint &endpoint, const Args &...args); // fetches an empty cache
+  // Paths are keys joined by '.', e.g. "source.name"
+  template <typename T, typename... Args> T field(const InkEndpoint &endpoint, const char *path, const Args &...args);
+  template <typename T, typename... Args>
+  T itemField(const InkEndpoint &endpoint, const char *list, int index, const char *path, const Args &...args);
+  template <typename... Args> int listSize(const InkEndpoint &endpoint, const char *list, const Args &...args);
+#if INK_ENABLE_CANVAS
+  // Rows looked up by position or key in one of the Canvas indexes
+  template <typename Key, typename... Args>
+  Response indexRow(const InkEndpoint &endpoint, InkIndex InkBridge::*index, const Key &key, const Args &...args);
+  template <typename T, typename Key, typename... Args>
+  T indexField(const InkEndpoint &endpoint, InkIndex InkBridge::*index, const Key &key, const char *path, const Args &...args);
+#endif
+
+  struct RateBucket {
+    char endpoint[32];
+    float tokens;
+    float perMinute;
+    uint8_t burst;
+    uint32_t refilledAt;
+    uint32_t blockedUntil; // end of a Retry-After window, 0 when none
+  };
+  RateBucket _buckets[INK_MAX_RATE_LIMITS];
+  uint8_t _bucketCount;
+  float _defaultPerMinute;
+  uint8_t _defaultBurst;
+  RateBucket *bucketFor(const String &endpoint, bool create);
+  bool allowRequest(const String &endpoint);
+  void backOff(const String &endpoint, int httpCode, const String &retryAfter);
+  static bool keepsCache(const Response &fresh);
+
+  // API hosts, guarded by the INK_SOURCE_CONFIG lock
+  InkHostPool _hosts;
+  int pickHost(); // -1 while every host's breaker is open
+  void reportHost(int host, int httpCode, uint32_t elapsedMs, uint32_t &failed);
+
+  // Request queue: at most INK_MAX_ACTIVE_REQUESTS gated requests at once
+  uint8_t _activeRequests;
+  uint8_t _waitingRequests[INK_PRIORITY_COUNT];
+  bool acquireSlot(InkPriority priority, uint32_t deadline = 0); // false when the deadline passed while queued
+  void releaseSlot(InkPriority priority);
+
+  void initState();
+  void identify(JsonDocument &doc); // adds uid and device_id
+  bool missing(InkSource source, const Response &response, const bool *decoded = nullptr);
+  Response store(InkSource source, Response &target, Response &&fresh);
+
+  // Pre-warming and DNS cache, guarded by the INK_SOURCE_CONFIG lock
+  bool _prewarmEnabled;
+  TaskHandle_t _prewarmTask;
+  WiFiClientSecure *_warmClient;
+  String _warmBase; // API base URL the warm client is connected to
+  uint32_t _warmAt;
+  String _dnsHost;
+  IPAddress _dnsAddress;
+  uint32_t _dnsAt;
+  wifi_event_id_t _wifiEvent;
+  static void prewarmTask(void *arg);
+  void onConnected(); // WiFi got an address
+  static bool apiHost(const char *base, char *host, size_t size, uint16_t &port);
+  bool resolveApiHost(const char *host, IPAddress &ip);
+  void forgetApiHost();
+  bool connectCached(WiFiClientSecure &client, const char *base);
+  WiFiClientSecure *takeWarmClient(int host, uint32_t deadline = 0); // nullptr unless warmed for this host (-1: any)
+
+  // Client objects and heap history, guarded by the INK_SOURCE_CONFIG lock
+  bool _steadyState;
+  InkObjectPool<WiFiClientSecure, INK_STEADY_CONNECTIONS> _clientPool;
+  InkObjectPool<HTTPClient, INK_STEADY_CONNECTIONS> _httpPool;
+  InkHeapMonitor _heap;
+  WiFiClientSecure *newClient();
+  void dropClient(WiFiClientSecure *client);
+  HTTPClient *newHttp();
+  void dropHttp(HTTPClient *http);
+  void watchHeap(); // records a sample when one is due
+
+  // Pipelined mode
+  struct InkJob;
+  InkRingBuffer _ring;
+  QueueHandle_t _jobQueue[INK_PRIORITY_COUNT];
+  SemaphoreHandle_t _jobSignal; // counts queued jobs across the classes
+  QueueHandle_t _parseQueue;
+  QueueHandle_t _resultQueue;
+  SemaphoreHandle_t _parseDone; // ring drained, the next transfer may start
+  SemaphoreHandle_t _pipeStopped; // given by each pipeline task as it exits
+  TaskHandle_t _netTask;
+  TaskHandle_t _parseTask;
+  static void networkTask(void *arg);
+  static void parserTask(void *arg);
+  bool submit(InkJob *job);
+  void transfer(InkJob *job);
+  void parse(InkJob *job);
+
+  uint32_t _statCount[2]; // [sequential, pipelined]
+  uint64_t _statLatencyUs[2];
+  uint64_t _statParseUs[2];
+  uint32_t _waitCount[INK_PRIORITY_COUNT];
+  uint64_t _waitTotalUs[INK_PRIORITY_COUNT];
+  uint32_t _waitMaxUs[INK_PRIORITY_COUNT];
+  uint64_t _bytesSent;
+  uint64_t _bytesReceived;
+  void recordTiming(bool pipelined, InkPriority priority, const InkTiming &timing);
+  void recordTraffic(size_t sent, size_t received);
+
+#if INK_ENABLE_NEWS || INK_ENABLE_CALENDAR
+  bool _deltaSync;
+  void applySync(Response &local, Response &fresh, const char *listKey, const char *idKey, String &token, ChangeSet &changes);
+#endif
+#if INK_ENABLE_NEWS
+  InkPayload newsPayload(const String &category);
+  Response commitNews(const String &category, Response &&fresh);
+  String _newsSyncToken;
+  String _newsSyncCategory;
+  ChangeSet _newsChanges = {false, 0, -1};
+#endif
+#if INK_ENABLE_CALENDAR
+  InkPayload calendarPayload(const String &range);
+  Response commitCalendar(const String &range, Response &&fresh);
+  String _calendarSyncToken;
+  String _calendarSyncRange;
+  ChangeSet _calendarChanges = {false, 0, -1};
+#endif
+#if INK_ENABLE_STOCKS || INK_ENABLE_CRYPTO
+  InkTimeSeries *updateSeries(const InkEndpoint &endpoint, InkTimeSeries *pool, uint8_t &next, String symbol, int days);
+#endif
+#if INK_ENABLE_STOCKS
+  InkTimeSeries _stockSeries[INK_MAX_SERIES];
+  uint8_t _stockSeriesNext;
+#endif
+#if INK_ENABLE_CRYPTO
+  InkTimeSeries _cryptoSeries[INK_MAX_SERIES];
+  uint8_t _cryptoSeriesNext;
+#endif
+
+#if INK_ENABLE_CANVAS
+  // Rebuilt by getCanvas(); keyed by assignment id and course name
+  InkIndex _todoIndex;
+  InkIndex _gradeIndex;
+
+  // Grades parsed once per fetch, parallel to _gradeIndex
+  LetterGrade *_gradeCodes;
+  int _gradeCodeCount;
+  double _gpaCache[2]; // [unweighted, weighted]
+  bool _gpaValid[2];
+  uint32_t _gpaRevision;
+
+  void parseGrades();
+  double computeGPA(const GradeScale &scale, bool weighted);
+#endif
+
+#if INK_ENABLE_SPOTIFY
+  InkCommandJournal _journal;
+  bool _journalEnabled;
+  bool _replaying;
+  TaskHandle_t _replayTask;
+  static void replayTask(void *arg);
+  void startReplay();
+  Response sendPlayback(const InkCommandJournal::Command &command);
+  Response queuePlayback(const InkCommandJournal::Command &command);
+  static bool notSent(const Response &response);
+  InkNowPlaying _nowPlaying;
+  uint32_t _nowPlayingDriftMs;
+  void syncNowPlaying();
+#endif
+
+#if INK_ENABLE_WEATHER
+  void decodeWeather(const Response &response, WeatherNow &out);
+  void decodeForecast(const Response &response, WeatherForecast &out);
+  void decodeHistory(const Response &response, WeatherHistory &out);
+  void decodeAstronomy(const Response &response, Astronomy &out);
+  int findForecastDay(const String &date);
+
+  struct AstronomySite {
+    char key[48];  // location string as passed to getAstronomy()
+    char name[48]; // display name returned by the server
+    double lat;
+    double lon;
+  };
+  AstronomySite _sites[INK_MAX_SITES];
+  uint8_t _siteCount;
+  uint8_t _siteNext; // slot replaced once the table is full
+  bool _localAstronomy;
+  int findSite(const String &location);
+  void learnSite(const String &location, JsonVariantConst data);
+  bool computeAstronomy(const String &location, Response &out);
+
+  InkHistoryStore _history; // days for one location, swapped in from NVS on demand
+  bool _historyLoaded;
+  // Dates requested for the selected location that the store does not keep:
+  // today, with the values of the last reply, or a date the reply lacked.
+  struct HistoryProbe {
+    bool used;
+    bool found;
+    uint32_t at; // millis() of the request
+    InkHistoryStore::Day record; // record.day is the date
+  };
+  HistoryProbe _historyProbes[INK_HISTORY_PROBES];
+  uint8_t _historyProbeNext;
+  HistoryProbe *findProbe(int32_t day);
+  HistoryProbe *noteProbe(int32_t day, const InkHistoryStore::Day *record);
+  Response fetchHistory(const String &location, const String &date, const String &endDate);
+  void selectHistory(const String &location);
+  void mergeHistory(const String &location, const Response &fresh);
+  bool historyDay(const String &date, const String &location, InkHistoryStore::Day &out);
+  static int32_t historyToday(); // local date as a day number, -1 before NTP sync
+#endif
+};
+
+// Shares one time budget between the InkBridge calls this task makes while the
+// scope is open. A nested scope can only shorten the outer budget.
+//   { InkDeadline frame(ink, 2000); ink.getWeather(); ink.getStock("AAPL"); }
+class InkDeadline {
+public:
+  InkDeadline(InkBridge &ink, uint32_t ms) : _ink(ink), _previous(ink.beginDeadline(ms)) {}
+  ~InkDeadline() { _ink.endDeadline(_previous); }
+
+private:
+  InkDeadline(const InkDeadline &);
+  InkDeadline &operator=(const InkDeadline &);
+
+  InkBridge &_ink;
+  uint32_t _previous;
 };
 
 #endif
\ No newline at end of file
@@ -19,19 +19,19 @@ bool NVSManager::isInit(){
   return nvs_init;
 }
 
-void NVSManager::saveString(const char* key, String value) {
+void NVSManager::saveString(const char* key, String value, const char* ns) {
   nvs_handle_t my_handle;
-  if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &my_handle) == ESP_OK) {
+  if (nvs_open(ns ? ns : NVS_NAMESPACE, NVS_READWRITE, &my_handle) == ESP_OK) {
     nvs_set_str(my_handle, key, value.c_str());
     nvs_commit(my_handle);
     nvs_close(my_handle);
   }
 }
 
-String NVSManager::loadString(const char* key) {
+String NVSManager::loadString(const char* key, const char* ns) {
   nvs_handle_t my_handle;
   String result = "";
-  if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &my_handle) == ESP_OK) {
+  if (nvs_open(ns ? ns : NVS_NAMESPACE, NVS_READWRITE, &my_handle) == ESP_OK) {
     size_t required_size;
     if (nvs_get_str(my_handle, key, NULL, &required_size) == ESP_OK) {
       char* buffer = (char*)malloc(required_size);
@@ -44,47 +44,87 @@ String NVSManager::loadString(const char* key) {
   return result;
 }
 
-void NVSManager::saveApi(String api) {
-  saveString("apikey", api);
+void NVSManager::saveBlob(const char* key, const void* data, size_t len, const char* ns) {
+  nvs_handle_t my_handle;
+  if (nvs_open(ns ? ns : NVS_NAMESPACE, NVS_READWRITE, &my_handle) == ESP_OK) {
+    nvs_set_blob(my_handle, key, data, len);
+    nvs_commit(my_handle);
+    nvs_close(my_handle);
+  }
 }
 
-void NVSManager::saveDeviceId(String deviceId) {
-  saveString("deviceId", deviceId);
+size_t NVSManager::loadBlob(const char* key, void* data, size_t len, const char* ns) {
+  nvs_handle_t my_handle;
+  size_t result = 0;
+  if (nvs_open(ns ? ns : NVS_NAMESPACE, NVS_READWRITE, &my_handle) == ESP_OK) {
+    size_t required_size;
+    if (nvs_get_blob(my_handle, key, NULL, &required_size) == ESP_OK && required_size <= len &&
+        nvs_get_blob(my_handle, key, data, &required_size) == ESP_OK) {
+      result = required_size;
+    }
+    nvs_close(my_handle);
+  }
+  return result;
 }
 
-void NVSManager::saveApiUrl(String url) {
-  saveString("apiurl", url);
+void NVSManager::saveApi(String api, const char* ns) {
+  saveString("apikey", api, ns);
 }
 
-void NVSManager::saveFriendlyUser(String user) {
-  saveString("friendlyuser", user);
+void NVSManager::saveDeviceId(String deviceId, const char* ns) {
+  saveString("deviceId", deviceId, ns);
 }
 
-void NVSManager::saveUID(String uid) {
-  saveString("uid", uid);
+void NVSManager::saveApiUrl(String url, const char* ns) {
+  saveString("apiurl", url, ns);
 }
 
-String NVSManager::loadApi() {
-  return loadString("apikey");
+void NVSManager::saveFriendlyUser(String user, const char* ns) {
+  saveString("friendlyuser", user, ns);
 }
 
-String NVSManager::loadDeviceId() {
-  return loadString("deviceId");
+void NVSManager::saveUID(String uid, const char* ns) {
+  saveString("uid", uid, ns);
 }
 
-String NVSManager::loadUID() {
-  return loadString("uid");
+void NVSManager::saveApiHosts(String hosts, const char* ns) {
+  saveString("apihosts", hosts, ns);
 }
 
-String NVSManager::loadApiUrl() {
-  return loadString("apiurl");
+String NVSManager::loadApi(const char* ns) {
+  return loadString("apikey", ns);
 }
 
-String NVSManager::loadFriendlyUser() {
-  return loadString("friendlyuser");
+String NVSManager::loadDeviceId(const char* ns) {
+  return loadString("deviceId", ns);
+}
+
+String NVSManager::loadUID(const char* ns) {
+  return loadString("uid", ns);
+}
+
+String NVSManager::loadApiUrl(const char* ns) {
+  return loadString("apiurl", ns);
+}
+
+String NVSManager::loadFriendlyUser(const char* ns) {
+  return loadString("friendlyuser", ns);
+}
+
+String NVSManager::loadApiHosts(const char* ns) {
+  return loadString("apihosts", ns);
 }
 
 void NVSManager::factoryReset() {
   nvs_flash_erase();
   nvs_flash_init();
-}
\ No newline at end of file
+}
+
+void NVSManager::eraseNamespace(const char* ns) {
+  nvs_handle_t my_handle;
+  if (nvs_open(ns ? ns : NVS_NAMESPACE, NVS_READWRITE, &my_handle) == ESP_OK) {
+    nvs_erase_all(my_handle);
+    nvs_commit(my_handle);
+    nvs_close(my_handle);
+  }
+}
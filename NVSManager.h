@@ -10,21 +10,29 @@ public:
   static void init();  // Call nvs_flash_init here
   static bool isInit();
 
-  static void saveApi(String api);
-  static void saveDeviceId(String deviceId);
-  static void saveApiUrl(String url);
-  static void saveFriendlyUser(String user);
-  static void saveUID(String uid);
+  // ns selects an NVS namespace (max 15 chars); nullptr uses the default one
+  static void saveApi(String api, const char* ns = nullptr);
+  static void saveDeviceId(String deviceId, const char* ns = nullptr);
+  static void saveApiUrl(String url, const char* ns = nullptr);
+  static void saveFriendlyUser(String user, const char* ns = nullptr);
+  static void saveUID(String uid, const char* ns = nullptr);
+  static void saveApiHosts(String hosts, const char* ns = nullptr); // one URL per line
   static void factoryReset();
-  static String loadApi();
-  static String loadApiUrl();
-  static String loadDeviceId();
-  static String loadUID();
-  static String loadFriendlyUser();
+  static void eraseNamespace(const char* ns); // clears one namespace only
+  static String loadApi(const char* ns = nullptr);
+  static String loadApiUrl(const char* ns = nullptr);
+  static String loadDeviceId(const char* ns = nullptr);
+  static String loadUID(const char* ns = nullptr);
+  static String loadFriendlyUser(const char* ns = nullptr);
+  static String loadApiHosts(const char* ns = nullptr);
+
+  // Raw bytes under one key; loadBlob returns the stored size, 0 if missing or larger than len
+  static void saveBlob(const char* key, const void* data, size_t len, const char* ns = nullptr);
+  static size_t loadBlob(const char* key, void* data, size_t len, const char* ns = nullptr);
 
 private:
-  static void saveString(const char* key, String value);
-  static String loadString(const char* key);
+  static void saveString(const char* key, String value, const char* ns);
+  static String loadString(const char* key, const char* ns);
   static const char* NVS_NAMESPACE;
   static bool nvs_init;
 };
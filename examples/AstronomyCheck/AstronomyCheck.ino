@@ -0,0 +1,141 @@
+// Accuracy test for the on-device astronomy calculator. Each fixture holds the
+// rise and set times the /weather/astronomy endpoint reports for one location
+// and date. The sketch sets the clock to that date, computes the same fields
+// locally through getAstronomy() and prints PASS/FAIL per field and overall.
+// No WiFi is needed.
+//
+// The seed rows are reference almanac times, not server recordings. Replace
+// or extend them with rows recorded from the server.
+//
+// Build with -DASTRO_RECORD=1 to record new fixtures instead. The sketch then
+// asks the server for today's values at each fixture location and prints them
+// as table rows ready to paste below.
+
+#include "Inkbridge.h"
+#include <sys/time.h>
+
+#define SSID "your_ssid"
+#define PASSWORD "your_password"
+
+#ifndef ASTRO_RECORD
+#define ASTRO_RECORD 0
+#endif
+#ifndef ASTRO_SUN_TOLERANCE_MIN
+#define ASTRO_SUN_TOLERANCE_MIN 2
+#endif
+#ifndef ASTRO_MOON_TOLERANCE_MIN
+#define ASTRO_MOON_TOLERANCE_MIN 5
+#endif
+
+struct Fixture {
+  const char *location;
+  double lat;
+  double lon;
+  const char *tz;   // POSIX TZ string for the location
+  const char *date; // local date, YYYY-MM-DD
+  // Server values in its "hh:mm AM" format; nullptr skips the field
+  const char *sunrise;
+  const char *sunset;
+  const char *moonrise;
+  const char *moonset;
+};
+
+static const Fixture FIXTURES[] = {
+    {"Seattle", 47.6062, -122.3321, "PST8PDT,M3.2.0,M11.1.0", "2024-06-15", "05:11 AM", "09:10 PM", "02:44 PM", "01:49 AM"},
+    {"London", 51.5074, -0.1278, "GMT0BST,M3.5.0/1,M10.5.0", "2024-06-20", "04:43 AM", "09:21 PM", nullptr, nullptr},
+    {"London", 51.5074, -0.1278, "GMT0BST,M3.5.0/1,M10.5.0", "2024-12-21", "08:04 AM", "03:53 PM", nullptr, nullptr},
+    {"Sydney", -33.8688, 151.2093, "AEST-10AEDT,M10.1.0,M4.1.0/3", "2024-06-21", "07:00 AM", "04:54 PM", nullptr, nullptr},
+};
+
+InkBridge ink(false);
+
+// Minutes since midnight for "hh:mm AM", -1 if the text is not a time
+static int minutesOf(const char *text) {
+  int h, m;
+  char ampm[3];
+  if (!text || sscanf(text, "%d:%d %2s", &h, &m, ampm) != 3) return -1;
+  if (h == 12) h = 0;
+  if (ampm[0] == 'P') h += 12;
+  return h * 60 + m;
+}
+
+static void useZone(const char *tz) {
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+#if ASTRO_RECORD
+void setup() {
+  Serial.begin(115200);
+  WiFi.begin(SSID, PASSWORD);
+  while (WiFi.status() != WL_CONNECTED) delay(500);
+  configTime(0, 0, "pool.ntp.org");
+  while (time(nullptr) < 100000) delay(100);
+  ink.begin();
+  ink.setLocalAstronomy(false);
+
+  for (const Fixture &f : FIXTURES) {
+    useZone(f.tz);
+    Response server = ink.getAstronomy(f.location);
+    if (server.status != "OK") {
+      Serial.printf("// %s: %s\n", f.location, server.status.c_str());
+      continue;
+    }
+    time_t now = time(nullptr);
+    char date[11];
+    strftime(date, sizeof(date), "%Y-%m-%d", localtime(&now));
+    Serial.printf("    {\"%s\", %.4f, %.4f, \"%s\", \"%s\", \"%s\", \"%s\", \"%s\", \"%s\"},\n", f.location, f.lat, f.lon,
+                  f.tz, date, server.data["sunrise"].as<const char *>(), server.data["sunset"].as<const char *>(),
+                  server.data["moonrise"].as<const char *>(), server.data["moonset"].as<const char *>());
+  }
+}
+#else
+static int failures = 0;
+static int checks = 0;
+
+static void check(const char *field, const char *expected, const char *actual, int tolerance) {
+  if (!expected) return;
+  checks++;
+  int a = minutesOf(expected), b = minutesOf(actual);
+  int diff = 0;
+  bool pass;
+  if (a < 0 || b < 0) {
+    pass = actual && strcmp(expected, actual) == 0; // "--:--" when the body does not rise or set
+  } else {
+    diff = (b - a + 1440) % 1440;
+    if (diff > 720) diff -= 1440; // across midnight
+    pass = abs(diff) <= tolerance;
+  }
+  if (!pass) failures++;
+  Serial.printf("  %-4s %-9s expected %-9s local %-9s diff %+d min (tolerance %d)\n", pass ? "PASS" : "FAIL", field,
+                expected, actual ? actual : "null", diff, tolerance);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  for (const Fixture &f : FIXTURES) {
+    useZone(f.tz);
+    struct tm noon = {};
+    if (sscanf(f.date, "%d-%d-%d", &noon.tm_year, &noon.tm_mon, &noon.tm_mday) != 3) continue;
+    noon.tm_year -= 1900;
+    noon.tm_mon -= 1;
+    noon.tm_hour = 12;
+    noon.tm_isdst = -1;
+    struct timeval tv = {mktime(&noon), 0};
+    settimeofday(&tv, nullptr);
+
+    ink.setAstronomyCoordinates(f.lat, f.lon, f.location);
+    Response local = ink.getAstronomy(f.location);
+    Serial.printf("%s %s\n", f.location, f.date);
+    check("sunrise", f.sunrise, local.data["sunrise"].as<const char *>(), ASTRO_SUN_TOLERANCE_MIN);
+    check("sunset", f.sunset, local.data["sunset"].as<const char *>(), ASTRO_SUN_TOLERANCE_MIN);
+    check("moonrise", f.moonrise, local.data["moonrise"].as<const char *>(), ASTRO_MOON_TOLERANCE_MIN);
+    check("moonset", f.moonset, local.data["moonset"].as<const char *>(), ASTRO_MOON_TOLERANCE_MIN);
+  }
+  Serial.printf("ASTRONOMY %s: %d of %d checks failed\n", failures ? "FAIL" : "PASS", failures, checks);
+}
+#endif
+
+void loop() {}
@@ -0,0 +1,260 @@
+// Offline benchmark for the request, parse and accessor paths.
+//
+// Every request is answered from the recorded fixtures below through
+// setFixtureHook(), so no WiFi, registration or network is involved and runs are
+// repeatable. Results are printed one JSON object per line, prefixed with
+// "BENCH ". Capture the serial output for two builds and compare them with
+//   python3 tools/bench_compare.py before.log after.log
+
+#include "Inkbridge.h"
+#include <esp_heap_caps.h>
+
+#ifndef BENCH_FETCH_ITERATIONS
+#define BENCH_FETCH_ITERATIONS 200
+#endif
+#ifndef BENCH_PARSE_ITERATIONS
+#define BENCH_PARSE_ITERATIONS 200
+#endif
+#ifndef BENCH_ACCESSOR_CALLS
+#define BENCH_ACCESSOR_CALLS 1000000
+#endif
+
+InkBridge ink(false);
+
+struct Fixture
+{
+  const char *key; // endpoint, plus "#type" for Canvas
+  const char *json;
+};
+
+static const Fixture fixtures[] = {
+    {"/weather", R"({"temperature":18.4,"condition":"Clouds","description":"broken clouds","location":"Seattle, US"})"},
+    {"/weather/forecast", R"({"location":"Seattle, US","trend":"warming","forecast":[
+      {"date":"2026-10-18","min_temp":9.1,"max_temp":15.2,"condition":"Rain"},
+      {"date":"2026-10-19","min_temp":10.4,"max_temp":16.8,"condition":"Clouds"},
+      {"date":"2026-10-20","min_temp":11.0,"max_temp":18.3,"condition":"Clear"}]})"},
+    {"/weather/history", R"({"location":"Seattle, US","trend":"cooling","history":[
+      {"date":"2026-10-15","avg_temp":14.2,"condition":"Clear"},
+      {"date":"2026-10-16","avg_temp":13.1,"condition":"Clouds"},
+      {"date":"2026-10-17","avg_temp":12.5,"condition":"Rain"}]})"},
+    {"/weather/astronomy", R"({"location":"Seattle, US","sunrise":"07:31 AM","sunset":"06:12 PM","moonrise":"03:02 PM",
+      "moonset":"01:45 AM","moon_phase":"Waxing Gibbous","moon_illumination":78,"is_daytime":true})"},
+    {"/stock", R"({"symbol":"AAPL","price":231.42,"change_percent":1.27,"day_high":232.10,"day_low":228.95})"},
+    {"/stock/array", R"({"symbol":"AAPL","prices":[
+      {"timestamp":1760313600,"close":226.1},{"timestamp":1760400000,"close":227.9},{"timestamp":1760486400,"close":229.4},
+      {"timestamp":1760572800,"close":228.2},{"timestamp":1760659200,"close":230.8},{"timestamp":1760745600,"close":231.4}]})"},
+    {"/crypto", R"({"symbol":"BTC","name":"Bitcoin","price":67412.55,"change_percent":-0.84})"},
+    {"/crypto/array", R"({"symbol":"BTC","prices":[
+      {"timestamp":1760313600,"price":66120.4},{"timestamp":1760400000,"price":66980.1},{"timestamp":1760486400,"price":67802.9},
+      {"timestamp":1760572800,"price":67150.0},{"timestamp":1760659200,"price":67733.2},{"timestamp":1760745600,"price":67412.5}]})"},
+    {"/news", R"({"sync_token":"n-1042","articles":[
+      {"title":"Council approves new light rail extension","url":"https://news.example/a1","source":{"name":"City Desk"},"publishedAt":"2026-10-18T07:02:00Z","description":"The extension adds six stations and is due to open in 2031."},
+      {"title":"Chipmaker posts record quarter on AI demand","url":"https://news.example/a2","source":{"name":"Markets Wire"},"publishedAt":"2026-10-18T06:40:00Z","description":"Revenue rose 38 percent year over year, beating estimates."},
+      {"title":"Storm system to bring heavy rain to the coast","url":"https://news.example/a3","source":{"name":"Weather Now"},"publishedAt":"2026-10-18T06:15:00Z","description":"Forecasters expect up to 60 mm of rain through Tuesday."},
+      {"title":"Researchers map deep-sea vents in unprecedented detail","url":"https://news.example/a4","source":{"name":"Science Daily"},"publishedAt":"2026-10-18T05:58:00Z","description":"Autonomous submarines surveyed 200 square kilometres of seafloor."},
+      {"title":"Local team clinches playoff spot","url":"https://news.example/a5","source":{"name":"Sports Line"},"publishedAt":"2026-10-18T05:20:00Z","description":"A late goal sealed the result in front of a sold-out crowd."},
+      {"title":"New library branch opens downtown","url":"https://news.example/a6","source":{"name":"City Desk"},"publishedAt":"2026-10-18T04:45:00Z","description":"The branch includes a makerspace and extended weekend hours."}]})"},
+    {"/calendar", R"({"sync_token":"c-318","events":[
+      {"id":"e1","summary":"Standup","start":"2026-10-18T09:00:00-07:00","end":"2026-10-18T09:15:00-07:00","location":"Zoom"},
+      {"id":"e2","summary":"Design review","start":"2026-10-18T11:00:00-07:00","end":"2026-10-18T12:00:00-07:00","location":"Room 4B"},
+      {"id":"e3","summary":"Lunch with Sam","start":"2026-10-18T12:30:00-07:00","end":"2026-10-18T13:30:00-07:00","location":"Cafe Luna"},
+      {"id":"e4","summary":"Dentist","start":"2026-10-18T15:00:00-07:00","end":"2026-10-18T15:45:00-07:00","location":"Main St Clinic"},
+      {"id":"e5","summary":"Gym","start":"2026-10-18T18:00:00-07:00","end":"2026-10-18T19:00:00-07:00","location":"Downtown"},
+      {"id":"e6","summary":"Call parents","start":"2026-10-18T20:00:00-07:00","end":"2026-10-18T20:30:00-07:00","location":""}]})"},
+    {"/travel", R"({"start_address":"Seattle, WA","end_address":"Bellevue, WA","distance_text":"16.2 km","duration_traffic_text":"24 mins","mode":"driving"})"},
+    {"/canvas#todo", R"([
+      {"id":5101,"name":"Lab report 3","due_at":"2026-10-20T23:59:00Z","type":"assignment"},
+      {"id":5102,"name":"Problem set 6","due_at":"2026-10-19T23:59:00Z","type":"assignment"},
+      {"id":5103,"name":"Reading quiz","due_at":"2026-10-21T12:00:00Z","type":"quiz"},
+      {"id":5104,"name":"Essay draft","due_at":"2026-10-24T23:59:00Z","type":"assignment"}])"},
+    {"/canvas#grades", R"([
+      {"course_name":"Biology","grade":"A-","score":91},
+      {"course_name":"Calculus","grade":"B+","score":88},
+      {"course_name":"History","grade":"A","score":95},
+      {"course_name":"Spanish","grade":"B","score":84}])"},
+    {"/spotify/devices", R"({"devices":[{"id":"d1","name":"Kitchen","type":"Speaker","is_active":true,"volume_percent":40}]})"},
+    {"/spotify/playback", R"({"status":"ok"})"},
+};
+static const int fixtureCount = sizeof(fixtures) / sizeof(fixtures[0]);
+
+// ArduinoJson allocator that counts allocations and tracks the live and peak
+// bytes of the documents using it.
+struct CountingAllocator : ArduinoJson::Allocator
+{
+  uint32_t allocations = 0;
+  size_t live = 0;
+  size_t peak = 0;
+
+  void *allocate(size_t size) override
+  {
+    void *p = malloc(size);
+    if (p)
+      track(p, true);
+    allocations++;
+    return p;
+  }
+  void deallocate(void *p) override
+  {
+    if (p)
+      track(p, false);
+    free(p);
+  }
+  void *reallocate(void *p, size_t size) override
+  {
+    if (p)
+      track(p, false);
+    void *q = realloc(p, size);
+    if (q)
+      track(q, true);
+    allocations++;
+    return q;
+  }
+
+private:
+  void track(void *p, bool add)
+  {
+    size_t size = heap_caps_get_allocated_size(p);
+    live = add ? live + size : live - size;
+    if (live > peak)
+      peak = live;
+  }
+};
+
+static uint32_t hookEnteredUs;
+static size_t hookPayloadBytes;
+
+static const char *findFixture(const String &key)
+{
+  for (int i = 0; i < fixtureCount; i++)
+  {
+    if (key == fixtures[i].key)
+      return fixtures[i].json;
+  }
+  return nullptr;
+}
+
+static bool answerFromFixture(const String &endpoint, const String &payload, Response &response)
+{
+  hookEnteredUs = micros();
+  hookPayloadBytes = payload.length();
+  String key = endpoint;
+  if (endpoint == "/canvas")
+    key += payload.indexOf("\"grades\"") >= 0 ? "#grades" : "#todo";
+  const char *json = findFixture(key);
+  if (!json)
+    return false;
+  deserializeJson(response.data, json);
+  response.status = "OK";
+  return true;
+}
+
+static size_t freeHeap()
+{
+  return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+// Full call: payload build (call until the request would be sent), fixture
+// parse, caching and decoding.
+static void benchFetch(const char *name, std::function<void()> call)
+{
+  uint64_t buildUs = 0, callUs = 0;
+  call(); // warm-up, so caches and one-time allocations are not counted
+  size_t heapBefore = freeHeap();
+  for (int i = 0; i < BENCH_FETCH_ITERATIONS; i++)
+  {
+    uint32_t start = micros();
+    call();
+    uint32_t end = micros();
+    buildUs += hookEnteredUs - start;
+    callUs += end - start;
+  }
+  long heapDelta = (long)heapBefore - (long)freeHeap();
+  Serial.printf("BENCH {\"bench\":\"fetch\",\"name\":\"%s\",\"iterations\":%d,\"build_us\":%.2f,\"call_us\":%.2f,"
+                "\"payload_bytes\":%u,\"heap_retained\":%ld}\n",
+                name, BENCH_FETCH_ITERATIONS, (double)buildUs / BENCH_FETCH_ITERATIONS,
+                (double)callUs / BENCH_FETCH_ITERATIONS, (unsigned)hookPayloadBytes, heapDelta);
+}
+
+// Parse only, with allocations counted per document.
+static void benchParse(const Fixture &fixture)
+{
+  CountingAllocator allocator;
+  uint64_t parseUs = 0;
+  for (int i = 0; i < BENCH_PARSE_ITERATIONS; i++)
+  {
+    JsonDocument doc(&allocator);
+    uint32_t start = micros();
+    deserializeJson(doc, fixture.json);
+    parseUs += micros() - start;
+  }
+  Serial.printf("BENCH {\"bench\":\"parse\",\"name\":\"%s\",\"iterations\":%d,\"parse_us\":%.2f,"
+                "\"allocs_per_op\":%.2f,\"peak_bytes\":%u,\"input_bytes\":%u}\n",
+                fixture.key, BENCH_PARSE_ITERATIONS, (double)parseUs / BENCH_PARSE_ITERATIONS,
+                (double)allocator.allocations / BENCH_PARSE_ITERATIONS, (unsigned)allocator.peak,
+                (unsigned)strlen(fixture.json));
+}
+
+// Repeated reads from the cache, as a display refresh would do.
+static void benchAccessor(const char *name, std::function<void()> call)
+{
+  call();
+  size_t heapBefore = freeHeap();
+  uint32_t start = micros();
+  for (long i = 0; i < BENCH_ACCESSOR_CALLS; i++)
+    call();
+  uint32_t elapsed = micros() - start;
+  long heapDelta = (long)heapBefore - (long)freeHeap();
+  Serial.printf("BENCH {\"bench\":\"accessor\",\"name\":\"%s\",\"calls\":%ld,\"ns_per_call\":%.1f,"
+                "\"calls_per_s\":%.0f,\"heap_retained\":%ld}\n",
+                name, (long)BENCH_ACCESSOR_CALLS, elapsed * 1000.0 / BENCH_ACCESSOR_CALLS,
+                BENCH_ACCESSOR_CALLS * 1e6 / (elapsed ? elapsed : 1), heapDelta);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  delay(1000);
+  ink.setFixtureHook(answerFromFixture);
+
+  for (int i = 0; i < fixtureCount; i++)
+    benchParse(fixtures[i]);
+
+  benchFetch("getWeather", [] { ink.getWeather("Seattle"); });
+  benchFetch("getWeatherForecast", [] { ink.getWeatherForecast("Seattle", 3); });
+  benchFetch("getWeatherHistory", [] { ink.getWeatherHistory("Seattle", ""); });
+  benchFetch("getAstronomy", [] { ink.getAstronomy("Seattle"); });
+  benchFetch("getStock", [] { ink.getStock("AAPL"); });
+  benchFetch("getStockArray", [] { ink.getStockArray("AAPL", 7); });
+  benchFetch("getCrypto", [] { ink.getCrypto("BTC"); });
+  benchFetch("getCryptoArray", [] { ink.getCryptoArray("BTC", 7); });
+  benchFetch("getNews", [] { ink.getNews("general"); });
+  benchFetch("getCalendar", [] { ink.getCalendar("1d"); });
+  benchFetch("getTravel", [] { ink.getTravel("Seattle", "Bellevue", "driving"); });
+  benchFetch("getCanvasTodo", [] { ink.getCanvas("todo", "school.instructure.com", "key"); });
+  benchFetch("getCanvasGrades", [] { ink.getCanvas("grades", "school.instructure.com", "key"); });
+  benchFetch("getSpotifyDevices", [] { ink.getSpotifyDevices(); });
+  benchFetch("spotifyPlayback", [] { ink.spotifyPlayback("next"); });
+
+  ink.setDecodeOnce(false);
+  ink.getWeatherForecast("Seattle", 3);
+  benchAccessor("getWeatherForecastMinTemp", [] { ink.getWeatherForecastMinTemp(1, "Seattle", 3); });
+  ink.setDecodeOnce(true);
+  ink.getWeatherForecast("Seattle", 3);
+  benchAccessor("getWeatherForecastMinTemp_decoded", [] { ink.getWeatherForecastMinTemp(1, "Seattle", 3); });
+  ink.setDecodeOnce(false);
+
+  benchAccessor("getWeatherTemperature", [] { ink.getWeatherTemperature("Seattle"); });
+  benchAccessor("getNewsArticleTitle", [] { ink.getNewsArticleTitle(3, "general"); });
+  benchAccessor("getCalendarEventTitle", [] { ink.getCalendarEventTitle(2, "1d"); });
+  benchAccessor("getCanvasLetterGrade", [] { ink.getCanvasLetterGrade("History"); });
+  benchAccessor("getGPAEstimate", [] { ink.getGPAEstimate(); });
+
+  Serial.printf("BENCH {\"bench\":\"memory\",\"name\":\"summary\",\"free_heap\":%u,\"min_free_heap\":%u,"
+                "\"largest_block\":%u}\n",
+                ESP.getFreeHeap(), ESP.getMinFreeHeap(), ESP.getMaxAllocHeap());
+  Serial.println("BENCH done");
+}
+
+void loop()
+{
+}
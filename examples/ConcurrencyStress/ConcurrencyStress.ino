@@ -0,0 +1,206 @@
+// Concurrency stress test for a single shared InkBridge. Several FreeRTOS tasks
+// on both cores refresh the caches with get*() while others read them through
+// the accessors and under lockSource(). Replies come from setFixtureHook(), so
+// no network is needed and refreshes run back to back.
+//
+// Every reply carries one generation number in all of its fields. A reader that
+// sees two generations in one read has observed a half-swapped cache (a torn
+// read). The sketch prints a "STRESS {...}" line per report interval and a final
+// PASS/FAIL: the run fails on any torn read, on a task that stops making
+// progress (deadlock), or when the previous boot ended in a panic or watchdog
+// reset (crash).
+
+#include "Inkbridge.h"
+#include <atomic>
+#include <esp_system.h>
+
+#ifndef STRESS_SECONDS
+#define STRESS_SECONDS 600
+#endif
+#ifndef STRESS_REPORT_MS
+#define STRESS_REPORT_MS 5000
+#endif
+#ifndef STRESS_STALL_MS
+#define STRESS_STALL_MS 10000 // a task without progress for this long is deadlocked
+#endif
+
+InkBridge ink(false);
+
+static std::atomic<uint32_t> generation(0);
+static std::atomic<uint32_t> torn(0);
+
+enum Role { REFRESHER, ACCESSOR, LOCKED_READER };
+
+struct Worker {
+  const char *name;
+  Role role;
+  BaseType_t core;
+  volatile uint32_t loops;
+  uint32_t seenLoops;
+  uint32_t progressAt;
+};
+
+static Worker workers[] = {
+    {"refresh-0", REFRESHER, 0},     {"refresh-1", REFRESHER, 1},     {"accessor-0", ACCESSOR, 0},
+    {"accessor-1", ACCESSOR, 1},     {"locked-0", LOCKED_READER, 0},  {"locked-1", LOCKED_READER, 1},
+};
+static const int WORKERS = sizeof(workers) / sizeof(workers[0]);
+
+static uint32_t started = 0;
+static uint32_t lastReport = 0;
+static bool stalled = false;
+
+// One generation per reply, repeated in every field and list element
+static bool fixture(const String &endpoint, const String &payload, Response &response) {
+  uint32_t gen = ++generation;
+  char json[512];
+  if (endpoint == "/weather") {
+    unsigned long t = gen % 1000000 + 1; // WeatherNow keeps the temperature as a float
+    snprintf(json, sizeof(json), "{\"temperature\":%lu,\"condition\":\"g%lu\",\"description\":\"g%lu\",\"location\":\"g%lu\"}",
+             t, t, t, t);
+  } else if (endpoint == "/news") {
+    int n = snprintf(json, sizeof(json), "{\"articles\":[");
+    for (uint32_t i = 0; i <= gen % 4; i++)
+      n += snprintf(json + n, sizeof(json) - n, "%s{\"title\":\"g%lu\",\"url\":\"u%lu\"}", i ? "," : "",
+                    (unsigned long)gen, (unsigned long)i);
+    snprintf(json + n, sizeof(json) - n, "]}");
+  } else if (endpoint == "/stock") {
+    snprintf(json, sizeof(json), "{\"symbol\":\"g%lu\",\"price\":%lu}", (unsigned long)gen, (unsigned long)gen);
+  } else {
+    return false;
+  }
+  deserializeJson(response.data, json);
+  return true;
+}
+
+static uint32_t genOf(const char *text) {
+  return text && text[0] == 'g' ? strtoul(text + 1, nullptr, 10) : 0;
+}
+
+static void check(bool ok, const char *what) {
+  if (!ok && torn++ < 10)
+    Serial.printf("STRESS torn read: %s\n", what);
+}
+
+static void refresh(uint32_t n) {
+  switch (n % 3) {
+  case 0: ink.getWeather(); break;
+  case 1: ink.getNews("general"); break;
+  default: ink.getStock("AAPL"); break;
+  }
+}
+
+// Each accessor call is one locked read, so every value it returns must be whole
+static void readAccessors() {
+  WeatherNow now = ink.getWeatherNow();
+  if (now.valid)
+    check((uint32_t)now.temperature == genOf(now.condition), "getWeatherNow");
+
+  String title = ink.getNewsArticleTitle(esp_random() % 4);
+  check(title.length() == 0 || genOf(title.c_str()) > 0, "getNewsArticleTitle");
+  ink.getNewsArticleCount();
+  ink.getWeatherTemperature();
+  ink.getStockPrice();
+}
+
+// Several fields under one lock must all come from the same reply
+static void readLocked() {
+  {
+    InkLock lock = ink.lockSource(INK_SOURCE_WEATHER);
+    if (!ink.weather.data.isNull()) {
+      uint32_t gen = ink.weather.data["temperature"].as<uint32_t>();
+      check(genOf(ink.weather.data["condition"].as<const char *>()) == gen &&
+                genOf(ink.weather.data["location"].as<const char *>()) == gen,
+            "weather under lock");
+    }
+  }
+  {
+    InkLock lock = ink.lockSource(INK_SOURCE_NEWS);
+    JsonArrayConst articles = ink.news.data["articles"];
+    if (articles.size() > 0) {
+      uint32_t gen = genOf(articles[0]["title"].as<const char *>());
+      check(articles.size() == gen % 4 + 1, "news count under lock");
+      for (JsonVariantConst article : articles)
+        check(genOf(article["title"].as<const char *>()) == gen, "news titles under lock");
+    }
+  }
+  {
+    InkLock lock = ink.lockSource(INK_SOURCE_STOCKS);
+    if (!ink.stocks.data.isNull())
+      check(genOf(ink.stocks.data["symbol"].as<const char *>()) == ink.stocks.data["price"].as<uint32_t>(),
+            "stock under lock");
+  }
+}
+
+static void workerTask(void *arg) {
+  Worker &w = *(Worker *)arg;
+  for (;;) {
+    switch (w.role) {
+    case REFRESHER: refresh(w.loops); break;
+    case ACCESSOR: readAccessors(); break;
+    case LOCKED_READER: readLocked(); break;
+    }
+    w.loops++;
+    if (w.loops % 16 == 0)
+      vTaskDelay(1); // let the idle task feed the watchdog
+  }
+}
+
+static void report(const char *phase) {
+  Serial.printf("STRESS {\"phase\":\"%s\",\"seconds\":%lu,\"generation\":%lu,\"torn\":%lu,\"free_heap\":%lu",
+                phase, (unsigned long)((millis() - started) / 1000), (unsigned long)generation.load(),
+                (unsigned long)torn.load(), (unsigned long)ESP.getFreeHeap());
+  for (int i = 0; i < WORKERS; i++)
+    Serial.printf(",\"%s\":%lu", workers[i].name, (unsigned long)workers[i].loops);
+  Serial.println("}");
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  esp_reset_reason_t reason = esp_reset_reason();
+  if (reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT) {
+    Serial.printf("STRESS FAIL: previous run crashed (reset reason %d)\n", (int)reason);
+    for (;;)
+      delay(1000);
+  }
+
+  ink.setFixtureHook(fixture);
+  ink.begin();
+
+  started = lastReport = millis();
+  for (int i = 0; i < WORKERS; i++) {
+    workers[i].progressAt = started;
+    xTaskCreatePinnedToCore(workerTask, workers[i].name, 8192, &workers[i], 1, nullptr, workers[i].core);
+  }
+}
+
+void loop() {
+  uint32_t now = millis();
+  for (int i = 0; i < WORKERS; i++) {
+    Worker &w = workers[i];
+    if (w.loops != w.seenLoops) {
+      w.seenLoops = w.loops;
+      w.progressAt = now;
+    } else if (now - w.progressAt > STRESS_STALL_MS && !stalled) {
+      stalled = true;
+      Serial.printf("STRESS %s made no progress for %lu ms\n", w.name, (unsigned long)(now - w.progressAt));
+    }
+  }
+
+  if (now - started >= (uint32_t)STRESS_SECONDS * 1000UL || stalled) {
+    report("done");
+    bool pass = torn == 0 && !stalled;
+    Serial.printf("STRESS %s: %lu torn reads, %s\n", pass ? "PASS" : "FAIL", (unsigned long)torn.load(),
+                  stalled ? "stalled" : "no stalls");
+    for (;;)
+      delay(1000);
+  }
+
+  if (now - lastReport >= STRESS_REPORT_MS) {
+    lastReport = now;
+    report("run");
+  }
+  delay(100);
+}
@@ -0,0 +1,178 @@
+// Runs several virtual InkBridge devices on one ESP32 against a local stand-in
+// server, to see what the client's request patterns look like server-side:
+// the /setup registration storm after a power cut, synchronized polling, and
+// how jitter, rate limits and caching change them.
+//
+// Start the server on a PC in the same network:
+//   python3 tools/fleet_server.py --port 8080
+// then set SIM_SERVER to its address. Every virtual client has its own fake MAC,
+// NVS namespace and polling task. The sketch prints a "FLEET {json}" line every
+// SIM_REPORT_MS; the server prints its own view (requests/s, burst peaks,
+// per-endpoint counts). Run the sketch on several boards for larger fleets.
+//
+// Plain http keeps the per-client cost low (no TLS session per client), so a
+// few dozen clients fit on one board.
+
+#include "Inkbridge.h"
+
+#define SSID "your_ssid"
+#define PASSWORD "your_password"
+
+#ifndef SIM_SERVER
+#define SIM_SERVER "http://192.168.1.50:8080"
+#endif
+#ifndef SIM_CLIENTS
+#define SIM_CLIENTS 16
+#endif
+#ifndef SIM_POLL_MS
+#define SIM_POLL_MS 30000
+#endif
+#ifndef SIM_REGISTER_JITTER_MS
+#define SIM_REGISTER_JITTER_MS 0 // try 5000 to spread the /setup storm
+#endif
+#ifndef SIM_POLL_JITTER_PERCENT
+#define SIM_POLL_JITTER_PERCENT 0 // try 10 to break up synchronized polling
+#endif
+#ifndef SIM_REPORT_MS
+#define SIM_REPORT_MS 10000
+#endif
+
+static InkBridge *clients[SIM_CLIENTS];
+
+// Latency histogram with power-of-two millisecond buckets: bucket i holds calls
+// that took less than 2^i ms.
+static const int LATENCY_BUCKETS = 17;
+static SemaphoreHandle_t statsLock;
+static uint32_t histogram[LATENCY_BUCKETS];
+static uint32_t requests, failures, rateLimited, registered;
+static uint32_t maxLatencyMs;
+
+static void record(const String &status, uint32_t ms)
+{
+  int bucket = 0;
+  while (bucket < LATENCY_BUCKETS - 1 && ms >= (1u << bucket))
+    bucket++;
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  histogram[bucket]++;
+  requests++;
+  if (status == "RATE_LIMITED")
+    rateLimited++;
+  else if (status != "OK")
+    failures++;
+  if (ms > maxLatencyMs)
+    maxLatencyMs = ms;
+  xSemaphoreGive(statsLock);
+}
+
+static uint32_t percentile(const uint32_t *counts, uint32_t total, float p)
+{
+  if (total == 0)
+    return 0;
+  uint32_t target = total * p, seen = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++)
+  {
+    seen += counts[i];
+    if (seen > target)
+      return 1u << i;
+  }
+  return 1u << (LATENCY_BUCKETS - 1);
+}
+
+static void clientTask(void *arg)
+{
+  InkBridge &ink = *(InkBridge *)arg;
+
+  uint32_t start = millis();
+  bool ok = ink.begin(); // includes the /setup call for a fresh device
+  record(ok ? "OK" : "FAIL", millis() - start);
+  if (ok)
+  {
+    xSemaphoreTake(statsLock, portMAX_DELAY);
+    registered++;
+    xSemaphoreGive(statsLock);
+  }
+
+  for (;;)
+  {
+    start = millis();
+    record(ink.getWeather("Seattle").status, millis() - start);
+    start = millis();
+    record(ink.getNews("general").status, millis() - start);
+    start = millis();
+    record(ink.getCalendar("1d").status, millis() - start);
+    vTaskDelay(pdMS_TO_TICKS(ink.pollInterval(SIM_POLL_MS)));
+  }
+}
+
+void connect_wifi()
+{
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(SSID, PASSWORD);
+  Serial.println("[WiFi] Connecting...");
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    delay(100);
+  }
+  Serial.print("[WiFi] Connected! IP: ");
+  Serial.println(WiFi.localIP());
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  connect_wifi();
+  statsLock = xSemaphoreCreateMutex();
+  NVSManager::init();
+
+  for (int i = 0; i < SIM_CLIENTS; i++)
+  {
+    char ns[16], mac[13];
+    snprintf(ns, sizeof(ns), "sim%03d", i);
+    snprintf(mac, sizeof(mac), "02F1EE7%05X", i); // locally administered range
+    NVSManager::eraseNamespace(ns);               // every run starts as a fresh fleet
+
+    clients[i] = new InkBridge(SIM_SERVER);
+    clients[i]->setStorageNamespace(ns);
+    clients[i]->setDeviceMac(mac);
+    clients[i]->setPrewarm(false);
+    clients[i]->setJitter(SIM_REGISTER_JITTER_MS, SIM_POLL_JITTER_PERCENT);
+  }
+
+  // All clients start together, like a fleet coming back after a power cut
+  for (int i = 0; i < SIM_CLIENTS; i++)
+    xTaskCreate(clientTask, "sim_client", 8192, clients[i], 1, nullptr);
+}
+
+void loop()
+{
+  static uint32_t lastReport = millis();
+  static uint32_t lastRequests = 0;
+  delay(SIM_REPORT_MS);
+
+  uint32_t counts[LATENCY_BUCKETS];
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  memcpy(counts, histogram, sizeof(counts));
+  uint32_t total = requests, failed = failures, limited = rateLimited, ready = registered, worst = maxLatencyMs;
+  xSemaphoreGive(statsLock);
+
+  uint64_t sent = 0, received = 0;
+  for (int i = 0; i < SIM_CLIENTS; i++)
+  {
+    InkLatencyStats stats = clients[i]->getLatencyStats();
+    sent += stats.bytesSent;
+    received += stats.bytesReceived;
+  }
+
+  uint32_t now = millis();
+  float rate = (total - lastRequests) * 1000.0f / (now - lastReport);
+  lastReport = now;
+  lastRequests = total;
+
+  Serial.printf("FLEET {\"elapsed_s\":%lu,\"clients\":%d,\"registered\":%lu,\"requests\":%lu,\"req_per_s\":%.2f,"
+                "\"failures\":%lu,\"rate_limited\":%lu,\"bytes_sent\":%llu,\"bytes_received\":%llu,"
+                "\"p50_ms\":%lu,\"p90_ms\":%lu,\"p99_ms\":%lu,\"max_ms\":%lu,\"free_heap\":%lu}\n",
+                (unsigned long)(now / 1000), SIM_CLIENTS, (unsigned long)ready, (unsigned long)total, rate,
+                (unsigned long)failed, (unsigned long)limited, (unsigned long long)sent, (unsigned long long)received,
+                (unsigned long)percentile(counts, total, 0.50f), (unsigned long)percentile(counts, total, 0.90f),
+                (unsigned long)percentile(counts, total, 0.99f), (unsigned long)worst, (unsigned long)ESP.getFreeHeap());
+}
@@ -0,0 +1,45 @@
+// Build target for tools/size_report.py. It calls a few functions of every
+// integration so the linker keeps them; the sketch is compiled, not run.
+// Build with -DINK_ENABLE_<NAME>=0 to see what one integration costs.
+
+#include "Inkbridge.h"
+
+InkBridge ink(false);
+
+void setup() {
+  Serial.begin(115200);
+  ink.begin();
+
+#if INK_ENABLE_WEATHER
+  Serial.println(ink.getWeatherTemperature());
+  Serial.println(ink.getWeatherForecastMinTemp(0));
+  Serial.println(ink.getWeatherHistoryAvgTemp(0));
+  Serial.println(ink.getAstronomySunrise());
+#endif
+#if INK_ENABLE_STOCKS
+  Serial.println(ink.getStockPrice("AAPL"));
+  Serial.println(ink.getStockSeries("AAPL") != nullptr);
+#endif
+#if INK_ENABLE_CRYPTO
+  Serial.println(ink.getCryptoPrice("BTC"));
+  Serial.println(ink.getCryptoSeries("BTC") != nullptr);
+#endif
+#if INK_ENABLE_NEWS
+  Serial.println(ink.getNewsArticleTitle(0));
+#endif
+#if INK_ENABLE_CALENDAR
+  Serial.println(ink.getCalendarEventTime(0));
+#endif
+#if INK_ENABLE_TRAVEL
+  Serial.println(ink.getTravelDuration("Home", "Work"));
+#endif
+#if INK_ENABLE_CANVAS
+  Serial.println(ink.getCanvas("assignments", "canvas.example.edu", "key").status);
+#endif
+#if INK_ENABLE_SPOTIFY
+  Serial.println(ink.getSpotifyPlaylists().status);
+  Serial.println(ink.spotifyPlayback("pause").status);
+#endif
+}
+
+void loop() {}
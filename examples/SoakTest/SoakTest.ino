@@ -0,0 +1,112 @@
+// Long-run soak test for steady-state mode. Cycles through the main requests
+// for SOAK_HOURS and prints one "SOAK {...}" JSON line per report interval with
+// the heap monitor's view and the arena statistics. The run passes when the
+// largest free block never drops more than SOAK_TOLERANCE bytes below its
+// level after the warm-up cycles, i.e. the heap is not fragmenting.
+//
+// Build with -DSOAK_OFFLINE=1 to answer every request from a small fixture
+// instead of the network (exercises documents and caches, not TLS).
+
+#include "Inkbridge.h"
+
+#define SSID "your_ssid"
+#define PASSWORD "your_password"
+
+#ifndef SOAK_HOURS
+#define SOAK_HOURS 72
+#endif
+#ifndef SOAK_INTERVAL_MS
+#define SOAK_INTERVAL_MS 20000 // between requests
+#endif
+#ifndef SOAK_REPORT_MS
+#define SOAK_REPORT_MS 600000
+#endif
+#ifndef SOAK_WARMUP_CYCLES
+#define SOAK_WARMUP_CYCLES 20 // caches fill and TLS buffers settle before the baseline
+#endif
+#ifndef SOAK_TOLERANCE
+#define SOAK_TOLERANCE 2048
+#endif
+#ifndef SOAK_OFFLINE
+#define SOAK_OFFLINE 0
+#endif
+
+InkBridge ink(false);
+
+static uint32_t cycles = 0;
+static uint32_t failures = 0;
+static uint32_t baselineBlock = 0;
+static uint32_t lowestBlock = UINT32_MAX;
+static uint32_t lastReport = 0;
+static uint32_t started = 0;
+
+static String runCycle(uint32_t n) {
+  switch (n % 4) {
+  case 0: return ink.getWeather().status;
+  case 1: return ink.getStock("AAPL").status;
+  case 2: return ink.getNews("general").status;
+  default: return ink.getCalendar("1d").status;
+  }
+}
+
+static void report(const char *phase) {
+  InkHeapSample now = ink.sampleHeap();
+  InkPoolStats pool = ink.getPoolStats();
+  Serial.printf("SOAK {\"phase\":\"%s\",\"minutes\":%lu,\"cycles\":%lu,\"failures\":%lu,\"free_heap\":%lu,"
+                "\"largest_block\":%lu,\"fragmentation\":%u,\"baseline_block\":%lu,\"lowest_block\":%lu,"
+                "\"arena_used\":%lu,\"arena_peak\":%lu,\"arena_fallbacks\":%lu,\"connection_misses\":%lu}\n",
+                phase, (unsigned long)((millis() - started) / 60000), (unsigned long)cycles, (unsigned long)failures,
+                (unsigned long)now.freeBytes, (unsigned long)now.largestBlock, now.fragmentation,
+                (unsigned long)baselineBlock, (unsigned long)(lowestBlock == UINT32_MAX ? 0 : lowestBlock),
+                (unsigned long)pool.used, (unsigned long)pool.peak, (unsigned long)pool.fallbacks,
+                (unsigned long)pool.connectionMisses);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+#if SOAK_OFFLINE
+  ink.setFixtureHook([](const String &endpoint, const String &payload, Response &response) {
+    deserializeJson(response.data, "{\"temperature\":18.4,\"condition\":\"Clouds\",\"price\":187.2,"
+                                   "\"articles\":[{\"title\":\"One\"},{\"title\":\"Two\"}],"
+                                   "\"events\":[{\"title\":\"Standup\",\"start\":\"09:00\"}]}");
+    return true;
+  });
+#else
+  WiFi.begin(SSID, PASSWORD);
+  while (WiFi.status() != WL_CONNECTED)
+    delay(500);
+#endif
+
+  ink.setSteadyState(true);
+  ink.begin();
+  started = millis();
+}
+
+void loop() {
+  if (millis() - started > (uint32_t)SOAK_HOURS * 3600000UL) {
+    report("done");
+    bool flat = lowestBlock + SOAK_TOLERANCE >= baselineBlock;
+    Serial.printf("SOAK %s: largest free block %lu -> lowest %lu\n", flat ? "PASS" : "FAIL",
+                  (unsigned long)baselineBlock, (unsigned long)lowestBlock);
+    for (;;)
+      delay(1000);
+  }
+
+  if (runCycle(cycles) != "OK")
+    failures++;
+  cycles++;
+
+  uint32_t block = InkHeapMonitor::read(millis()).largestBlock; // not recorded, the monitor keeps its own spacing
+  if (cycles == SOAK_WARMUP_CYCLES)
+    baselineBlock = block;
+  else if (cycles > SOAK_WARMUP_CYCLES && block < lowestBlock)
+    lowestBlock = block;
+
+  if (millis() - lastReport >= SOAK_REPORT_MS) {
+    lastReport = millis();
+    report(cycles > SOAK_WARMUP_CYCLES ? "run" : "warmup");
+  }
+  delay(SOAK_INTERVAL_MS);
+}
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Compare two captured runs of examples/Benchmark.
+
+Usage: bench_compare.py BEFORE.log AFTER.log [--threshold PERCENT]
+
+Reads the "BENCH {...}" lines from both serial logs and prints the change of
+every numeric metric. Exits with status 1 when a time or memory metric got worse
+by more than the threshold (default 10%), so it can gate a CI job.
+"""
+import argparse
+import json
+import sys
+
+# Metrics where a larger value is better; everything else is lower-is-better.
+HIGHER_IS_BETTER = {"calls_per_s", "free_heap", "min_free_heap", "largest_block"}
+# Descriptive counts that are not performance results.
+IGNORED = {"iterations", "calls", "input_bytes"}
+
+
+def load(path):
+    results = {}
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("BENCH {"):
+                continue
+            try:
+                entry = json.loads(line[len("BENCH "):])
+            except ValueError:
+                continue
+            results[(entry.pop("bench"), entry.pop("name"))] = entry
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two captured benchmark runs.")
+    parser.add_argument("before")
+    parser.add_argument("after")
+    parser.add_argument("--threshold", type=float, default=10.0, help="allowed regression in percent")
+    args = parser.parse_args()
+    threshold = args.threshold
+
+    before, after = load(args.before), load(args.after)
+    regressions = 0
+    for key in sorted(set(before) | set(after)):
+        if key not in before or key not in after:
+            print("%-10s %-36s only in %s" % (key[0], key[1], "after" if key in after else "before"))
+            continue
+        for metric, old in before[key].items():
+            new = after[key].get(metric)
+            if metric in IGNORED or not isinstance(old, (int, float)) or not isinstance(new, (int, float)):
+                continue
+            change = (new - old) * 100.0 / abs(old) if old else (0.0 if new == old else float("inf"))
+            worse = -change if metric in HIGHER_IS_BETTER else change
+            flag = ""
+            if worse > threshold:
+                flag = "  REGRESSION"
+                regressions += 1
+            print("%-10s %-36s %-16s %12g -> %-12g %+7.1f%%%s" % (key[0], key[1], metric, old, new, change, flag))
+
+    print("%d regression(s) above %.1f%%" % (regressions, threshold))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""Local stand-in for the InkBase API, for examples/FleetSimulator.
+
+Usage: fleet_server.py [--port 8080] [--latency-ms 0] [--capacity 0] [--report 10]
+
+Answers /setup and the data endpoints with canned payloads and prints one
+"SERVER {json}" line per report interval: requests/s, the busiest second
+(burst peak), distinct devices, bytes in and out, per-endpoint counts and
+handling latency percentiles. With --capacity N, requests beyond N per second
+get a 429 with Retry-After, to exercise the client back-off.
+"""
+import argparse
+import json
+import random
+import threading
+import time
+from collections import Counter
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+PAYLOADS = {
+    "/weather": {"temperature": 18.4, "condition": "Clouds", "description": "broken clouds", "location": "Seattle, US"},
+    "/weather/forecast": {"location": "Seattle, US", "trend": "warming", "forecast": [
+        {"date": "2026-10-18", "min_temp": 9.1, "max_temp": 15.2, "condition": "Rain"},
+        {"date": "2026-10-19", "min_temp": 10.4, "max_temp": 16.8, "condition": "Clouds"},
+        {"date": "2026-10-20", "min_temp": 11.0, "max_temp": 18.3, "condition": "Clear"}]},
+    "/stock": {"symbol": "AAPL", "price": 231.42, "change_percent": 1.27, "day_high": 232.1, "day_low": 228.95},
+    "/crypto": {"symbol": "BTC", "name": "Bitcoin", "price": 67412.55, "change_percent": -0.84},
+    "/news": {"sync_token": "n-1", "articles": [
+        {"title": "Headline %d" % i, "url": "https://news.example/%d" % i, "source": {"name": "Wire"},
+         "description": "Lorem ipsum dolor sit amet, consectetur adipiscing elit."} for i in range(10)]},
+    "/calendar": {"sync_token": "c-1", "events": [
+        {"id": "e%d" % i, "summary": "Event %d" % i, "start": "2026-10-18T%02d:00:00-07:00" % (9 + i),
+         "location": "Room %d" % i} for i in range(6)]},
+    "/travel": {"start_address": "Seattle, WA", "end_address": "Bellevue, WA", "distance_text": "16.2 km",
+                "duration_traffic_text": "24 mins", "mode": "driving"},
+}
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.reset()
+
+    def reset(self):
+        self.requests = 0
+        self.throttled = 0
+        self.bytes_in = 0
+        self.bytes_out = 0
+        self.endpoints = Counter()
+        self.per_second = Counter()
+        self.devices = set()
+        self.latencies = []
+
+
+stats = Stats()
+options = None
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p))]
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def do_GET(self):
+        self.handle_request(b"")
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        self.handle_request(self.rfile.read(length))
+
+    def handle_request(self, body):
+        start = time.time()
+        url = urlparse(self.path)
+        path = url.path
+        device = self.headers.get("x-device-id") or parse_qs(url.query).get("device_id", [""])[0]
+        second = int(start)
+
+        with stats.lock:
+            throttled = options.capacity > 0 and stats.per_second[second] >= options.capacity
+            stats.per_second[second] += 1
+
+        if options.latency_ms > 0:
+            time.sleep(random.uniform(0.5, 1.5) * options.latency_ms / 1000.0)
+
+        if throttled:
+            status, payload, extra = 429, {"status": "error", "message": "rate limited"}, {"Retry-After": "5"}
+        elif path == "/setup":
+            status, extra = 200, {}
+            payload = {"status": "success", "api_key": "key-" + device, "uid": "uid-" + device,
+                       "friendly_user_id": "sim-" + device[-4:]}
+        else:
+            status, extra = 200, {}
+            payload = PAYLOADS.get(path, {"status": "ok"})
+
+        data = json.dumps(payload).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        for key, value in extra.items():
+            self.send_header(key, value)
+        self.end_headers()
+        self.wfile.write(data)
+
+        with stats.lock:
+            stats.requests += 1
+            stats.throttled += 1 if throttled else 0
+            stats.bytes_in += len(body)
+            stats.bytes_out += len(data)
+            stats.endpoints[path] += 1
+            stats.devices.add(device)
+            stats.latencies.append((time.time() - start) * 1000.0)
+
+
+def report_loop():
+    started = time.time()
+    while True:
+        time.sleep(options.report)
+        with stats.lock:
+            peak = max(stats.per_second.values()) if stats.per_second else 0
+            line = {
+                "elapsed_s": int(time.time() - started),
+                "requests": stats.requests,
+                "req_per_s": round(stats.requests / float(options.report), 2),
+                "peak_per_s": peak,
+                "throttled": stats.throttled,
+                "devices": len(stats.devices),
+                "bytes_in": stats.bytes_in,
+                "bytes_out": stats.bytes_out,
+                "p50_ms": round(percentile(stats.latencies, 0.50), 1),
+                "p90_ms": round(percentile(stats.latencies, 0.90), 1),
+                "p99_ms": round(percentile(stats.latencies, 0.99), 1),
+                "endpoints": dict(stats.endpoints),
+            }
+            stats.reset()
+        print("SERVER " + json.dumps(line), flush=True)
+
+
+def main():
+    global options
+    parser = argparse.ArgumentParser(description="Local stand-in server for the fleet simulator.")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--latency-ms", type=float, default=0.0, help="simulated handling time")
+    parser.add_argument("--capacity", type=int, default=0, help="requests per second before 429s, 0 = unlimited")
+    parser.add_argument("--report", type=float, default=10.0, help="report interval in seconds")
+    options = parser.parse_args()
+
+    threading.Thread(target=report_loop, daemon=True).start()
+    server = ThreadingHTTPServer(("0.0.0.0", options.port), Handler)
+    print("Fleet server listening on port %d" % options.port, flush=True)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""Report the flash and RAM cost of each InkBridge integration.
+
+Usage: size_report.py [--fqbn FQBN] [--sketch DIR]
+
+Compiles examples/SizeReport with arduino-cli once with every integration
+enabled, then once per INK_ENABLE_* switch with only that one turned off. The
+difference to the full build is what the integration costs. Needs arduino-cli
+with the ESP32 core and ArduinoJson installed.
+"""
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+FEATURES = ["WEATHER", "STOCKS", "CRYPTO", "NEWS", "CALENDAR", "TRAVEL", "CANVAS", "SPOTIFY"]
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+FLASH = re.compile(r"Sketch uses (\d+) bytes")
+RAM = re.compile(r"Global variables use (\d+) bytes")
+
+
+def compile_size(fqbn, sketch, flags):
+    command = ["arduino-cli", "compile", "--fqbn", fqbn, "--library", ROOT, sketch]
+    if flags:
+        command += ["--build-property", "compiler.cpp.extra_flags=" + " ".join(flags)]
+    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    flash, ram = FLASH.search(result.stdout), RAM.search(result.stdout)
+    if result.returncode != 0 or not flash or not ram:
+        sys.stderr.write(result.stdout)
+        raise SystemExit("compile failed: %s" % " ".join(flags or ["(all enabled)"]))
+    return int(flash.group(1)), int(ram.group(1))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Per-integration code size of InkBridge.")
+    parser.add_argument("--fqbn", default="esp32:esp32:esp32")
+    parser.add_argument("--sketch", default=os.path.join(ROOT, "examples", "SizeReport"))
+    args = parser.parse_args()
+
+    full_flash, full_ram = compile_size(args.fqbn, args.sketch, [])
+    print("%-10s %10s %10s" % ("feature", "flash", "ram"))
+    print("%-10s %10d %10d" % ("(all)", full_flash, full_ram))
+    for feature in FEATURES:
+        flash, ram = compile_size(args.fqbn, args.sketch, ["-DINK_ENABLE_%s=0" % feature])
+        print("%-10s %10d %10d" % (feature.lower(), full_flash - flash, full_ram - ram))
+    bare_flash, bare_ram = compile_size(args.fqbn, args.sketch, ["-DINK_ENABLE_%s=0" % f for f in FEATURES])
+    print("%-10s %10d %10d" % ("(core)", bare_flash, bare_ram))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())